@@ -1,26 +1,40 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-
-int main() {
-    printf("[Welcome to the chess game, enter commnands without having to echo and then cat; enter \"exit\" to exit]\n");
-    int run = 1; 
-    while (run) {
-        char user_input[20];
-        printf("Enter a command: ");
-        fgets(user_input, sizeof(user_input), stdin);
-        if (strcmp(user_input, "exit\n") == 0) {
-            run = 0;
-        }
-        else {
-            char command[100];
-            snprintf(command, sizeof(command), "echo -n \"%s\" > /dev/chess", user_input);
-
-            system(command);
-
-            system("cat /dev/chess");
-        }
-    }
-    printf("Ending Program\n");
-    return EXIT_SUCCESS;
-}
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+int main() {
+    printf("[Welcome to the chess game, enter commnands without having to echo and then cat; enter \"exit\" to exit]\n");
+    // every open of the device is its own game, so keep one file open for the whole session
+    int fd = open("/dev/chess", O_RDWR);
+    if (fd < 0) {
+        perror("open /dev/chess");
+        return EXIT_FAILURE;
+    }
+    int run = 1;
+    while (run) {
+        char user_input[128];
+        printf("Enter a command: ");
+        if (fgets(user_input, sizeof(user_input), stdin) == NULL || strcmp(user_input, "exit\n") == 0) {
+            run = 0;
+        }
+        else {
+            char output[2048];
+            ssize_t bytes;
+
+            if (write(fd, user_input, strlen(user_input)) < 0) {
+                perror("write");
+                continue;
+            }
+
+            // the write rewinds the file, so read the response until the end
+            while ((bytes = read(fd, output, sizeof(output))) > 0) {
+                fwrite(output, 1, bytes, stdout);
+            }
+        }
+    }
+    close(fd);
+    printf("Ending Program\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include "../chess/chess_ioctl.h"
+
+// checks the module's move generator against perft counts of standard positions
+// usage: ./perft [maximum depth]
+
+struct reference {
+    const char *name;
+    const char *fen;
+    unsigned long long nodes[6]; // published counts for depths 1 to 6
+};
+
+// counts from the Chess Programming Wiki perft results page, kiwipete and position 5 are heavy on castling,
+// en passant, and promotions
+static const struct reference references[] = {
+    { "start", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+      { 20, 400, 8902, 197281, 4865609, 119060324 } },
+    { "kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+      { 48, 2039, 97862, 4085603, 193690690, 8031647685ULL } },
+    { "position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+      { 14, 191, 2812, 43238, 674624, 11030083 } },
+    { "position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+      { 6, 264, 9467, 422333, 15833292, 706045033 } },
+    { "position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+      { 44, 1486, 62379, 2103487, 89941194, 3048196529ULL } },
+};
+
+int main(int argc, char *argv[]) {
+    int max_depth = argc > 1 ? atoi(argv[1]) : 6;
+    int fd = open("/dev/chess", O_RDWR);
+    int failures = 0;
+    size_t i;
+
+    if (fd < 0) {
+        perror("open /dev/chess");
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < sizeof(references) / sizeof(references[0]); i++) {
+        const struct reference *ref = &references[i];
+        char command[128], output[64];
+        ssize_t bytes;
+        int depth;
+
+        // load the position through the text protocol, the counting goes through the ioctl
+        // a position whose side to move is in check, like position 4, loads with CHECK
+        snprintf(command, sizeof(command), "09 W %s\n", ref->fen);
+        bytes = write(fd, command, strlen(command)) < 0 ? -1 : read(fd, output, sizeof(output) - 1);
+        if (bytes < 0 || (strncmp(output, "OK\n", 3) != 0 && strncmp(output, "CHECK\n", 6) != 0)) {
+            printf("%s: could not load the position\n", ref->name);
+            failures++;
+            continue;
+        }
+
+        for (depth = 1; depth <= 6 && depth <= max_depth; depth++) {
+            struct chess_perft perft = { .version = CHESS_IOCTL_VERSION, .depth = depth };
+            if (ioctl(fd, CHESS_IOC_PERFT, &perft) < 0) {
+                perror("CHESS_IOC_PERFT");
+                close(fd);
+                return EXIT_FAILURE;
+            }
+            printf("%-10s depth %d: %12llu nodes %10.3f ms %8.2f Mnps %s\n", ref->name, depth,
+                   (unsigned long long)perft.nodes, perft.nanoseconds / 1e6, perft.nodes_per_second / 1e6,
+                   perft.nodes == ref->nodes[depth - 1] ? "PASS" : "FAIL");
+            if (perft.nodes != ref->nodes[depth - 1]) {
+                printf("%-10s expected %llu\n", "", ref->nodes[depth - 1]);
+                failures++;
+            }
+        }
+    }
+    close(fd);
+
+    printf("%d failures\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
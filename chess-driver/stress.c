@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "../chess/chess_ioctl.h"
+
+// hammers /dev/chess from many threads and checks that every response is whole and every board is sane
+// usage: ./stress [threads] [games per thread]
+
+static int games_per_thread = 5;
+static int shared_fd;
+static volatile int failures = 0;
+static volatile int running = 1;
+
+// sends a command and reads the response in one read from its start, which the device returns whole
+// the file position is shared by the threads of a shared file and not updated atomically, so it is not used
+static int command(int fd, const char *cmd, char *output, size_t size) {
+    ssize_t bytes;
+    if (write(fd, cmd, strlen(cmd)) != (ssize_t)strlen(cmd)) {
+        return -1;
+    }
+    bytes = pread(fd, output, size - 1, 0);
+    if (bytes < 0) {
+        return -1;
+    }
+    output[bytes] = '\0';
+    return 0;
+}
+
+static void fail(const char *what, const char *output) {
+    __sync_fetch_and_add(&failures, 1);
+    fprintf(stderr, "FAIL: %s\n%s\n", what, output);
+}
+
+// responses that a command can produce, anything else is a torn or corrupted message
+static int known_response(const char *output) {
+    static const char *responses[] = {
+        "", "OK\n", "CHECK\n", "NOGAME\n", "OOT\n", "ILLMOVE\n", "UNKCMD\n", "INVFMT\n",
+        "MATE\nWHITE WINS\n", "MATE\nBLACK WINS\n", "OK\nWHITE WINS\n", "OK\nBLACK WINS\n",
+        "DRAW\nREPETITION\n", "DRAW\nFIFTY MOVES\n", "DRAW\nSTALEMATE\n", "DRAW\nINSUFFICIENT MATERIAL\n",
+    };
+    size_t i;
+    for (i = 0; i < sizeof(responses) / sizeof(responses[0]); i++) {
+        if (strcmp(output, responses[i]) == 0) {
+            return 1;
+        }
+    }
+    return strncmp(output, "TT ", 3) == 0;
+}
+
+// determines if a response ends the game, with a win or a draw
+static int game_over(const char *output) {
+    return strstr(output, "WINS") != NULL || strncmp(output, "DRAW\n", 5) == 0;
+}
+
+// parses a displayed board into two character piece codes, returns 0 if it is malformed
+static int parse_board(const char *output, char board[8][8][3]) {
+    const char *p = output;
+    int row, col;
+    for (row = 0; row < 8; row++) {
+        if (p[0] != '1' + row || p[1] != ' ') {
+            return 0;
+        }
+        p += 2;
+        for (col = 0; col < 8; col++) {
+            // skip the color escape before and the reset escape after the piece
+            while (*p == '\033') {
+                p = strchr(p, 'm');
+                if (!p) {
+                    return 0;
+                }
+                p++;
+            }
+            board[row][col][0] = p[0];
+            board[row][col][1] = p[1];
+            board[row][col][2] = '\0';
+            p += 2;
+            while (*p == '\033') {
+                p = strchr(p, 'm');
+                if (!p) {
+                    return 0;
+                }
+                p++;
+            }
+            if (*p++ != ' ') {
+                return 0;
+            }
+        }
+        if (*p++ != '\n') {
+            return 0;
+        }
+    }
+    return strcmp(p, "  a  b  c  d  e  f  g  h\n") == 0;
+}
+
+// checks that both kings are on the board, no side has too many pieces, and no pawn is on the last rank
+static int board_invariants_hold(char board[8][8][3]) {
+    int kings[2] = { 0, 0 }, pieces[2] = { 0, 0 };
+    int row, col, color;
+    for (row = 0; row < 8; row++) {
+        for (col = 0; col < 8; col++) {
+            if (strcmp(board[row][col], "**") == 0) {
+                continue;
+            }
+            if ((board[row][col][0] != 'W' && board[row][col][0] != 'B') || !strchr("PNBRQK", board[row][col][1])) {
+                return 0;
+            }
+            color = board[row][col][0] == 'B';
+            pieces[color]++;
+            kings[color] += board[row][col][1] == 'K';
+            if (board[row][col][1] == 'P' && (row == 0 || row == 7)) {
+                return 0;
+            }
+        }
+    }
+    return kings[0] == 1 && kings[1] == 1 && pieces[0] <= 16 && pieces[1] <= 16;
+}
+
+// plays whole games on a private file, trying random moves for the player
+static void *play_games(void *arg) {
+    unsigned int seed = (unsigned int)(long)arg;
+    char output[2048], board[8][8][3], move[32];
+    int fd = open("/dev/chess", O_RDWR);
+    int game, turn, tries, row, col;
+
+    if (fd < 0) {
+        fail("open", "");
+        return NULL;
+    }
+    command(fd, "05 T5\n", output, sizeof(output));
+    for (game = 0; game < games_per_thread; game++) {
+        // every other game queues the CPU moves on the workqueue, whose response the read waits for
+        command(fd, game % 2 ? "07 A\n" : "07 S\n", output, sizeof(output));
+        command(fd, "00 W\n", output, sizeof(output));
+        for (turn = 0; turn < 200; turn++) {
+            if (command(fd, "01\n", output, sizeof(output)) || !parse_board(output, board)) {
+                fail("malformed board", output);
+                break;
+            }
+            if (!board_invariants_hold(board)) {
+                fail("board invariants", output);
+                break;
+            }
+
+            // try random moves of white pieces until one is accepted
+            for (tries = 0; tries < 2000; tries++) {
+                int to_row = rand_r(&seed) % 8, to_col = rand_r(&seed) % 8;
+                row = rand_r(&seed) % 8;
+                col = rand_r(&seed) % 8;
+                if (board[row][col][0] != 'W' || board[to_row][to_col][0] == 'W') {
+                    continue;
+                }
+                if (board[to_row][to_col][0] == 'B') {
+                    snprintf(move, sizeof(move), "02 %s%c%d-%c%dx%s\n", board[row][col], 'a' + col, row + 1,
+                             'a' + to_col, to_row + 1, board[to_row][to_col]);
+                } else {
+                    snprintf(move, sizeof(move), "02 %s%c%d-%c%d\n", board[row][col], 'a' + col, row + 1,
+                             'a' + to_col, to_row + 1);
+                }
+                command(fd, move, output, sizeof(output));
+                if (!known_response(output)) {
+                    fail("unknown response to a move", output);
+                }
+                if (strcmp(output, "ILLMOVE\n") != 0) {
+                    break;
+                }
+            }
+            if (tries == 2000 || game_over(output)) {
+                break;
+            }
+
+            command(fd, "03\n", output, sizeof(output));
+            if (!known_response(output)) {
+                fail("unknown response to a CPU move", output);
+            }
+            if (game_over(output)) {
+                break;
+            }
+        }
+    }
+    close(fd);
+    return NULL;
+}
+
+// sends commands on the shared file from several threads at once, each response must still be whole
+static void *share_game(void *arg) {
+    static const char *commands[] = { "01\n", "03\n", "06\n", "02 WPe2-e4\n", "04\n", "00 W\n", "05 T5\n" };
+    unsigned int seed = (unsigned int)(long)arg;
+    char output[2048], board[8][8][3];
+    int i;
+
+    for (i = 0; i < games_per_thread * 100; i++) {
+        const char *cmd = commands[rand_r(&seed) % (sizeof(commands) / sizeof(commands[0]))];
+        if (command(shared_fd, cmd, output, sizeof(output))) {
+            fail("shared command", cmd);
+            continue;
+        }
+        // another thread's response may be read, but never a partial or mixed one
+        if (output[0] == '1') {
+            if (!parse_board(output, board) || !board_invariants_hold(board)) {
+                fail("shared board", output);
+            }
+        } else if (!known_response(output)) {
+            fail("shared response", output);
+        }
+    }
+    return NULL;
+}
+
+// copies the mapped snapshot of the shared game while it changes, each copy must be a consistent board
+static void *watch_snapshot(void *arg) {
+    const volatile struct chess_snapshot *snapshot;
+    struct chess_snapshot copy;
+    unsigned int sequence, copies = 0;
+    int sq, kings;
+
+    snapshot = mmap(NULL, sizeof(*snapshot), PROT_READ, MAP_SHARED, shared_fd, 0);
+    if (snapshot == MAP_FAILED) {
+        fail("mmap", "");
+        return NULL;
+    }
+    while (running) {
+        do {
+            sequence = snapshot->sequence;
+            __sync_synchronize();
+            memcpy(&copy, (const void *)snapshot, sizeof(copy));
+            __sync_synchronize();
+        } while ((sequence & 1) || sequence != snapshot->sequence);
+
+        kings = 0;
+        for (sq = 0; sq < 64; sq++) {
+            kings += copy.squares[sq] % 6 == CHESS_KING && copy.squares[sq] != CHESS_EMPTY;
+        }
+        if ((copy.flags & CHESS_FLAG_STARTED) && kings != 2) {
+            fail("snapshot board", "");
+        }
+        copies++;
+    }
+    munmap((void *)snapshot, sizeof(*snapshot));
+    printf("%u snapshot copies\n", copies);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : 8;
+    pthread_t *ids, watcher;
+    int i;
+
+    if (argc > 2) {
+        games_per_thread = atoi(argv[2]);
+    }
+    shared_fd = open("/dev/chess", O_RDWR);
+    if (shared_fd < 0 || threads < 1) {
+        perror("open /dev/chess");
+        return EXIT_FAILURE;
+    }
+
+    // half of the threads play their own games, the other half share one game
+    ids = calloc(threads, sizeof(*ids));
+    for (i = 0; i < threads; i++) {
+        pthread_create(&ids[i], NULL, i % 2 ? share_game : play_games, (void *)(long)(i + 1));
+    }
+    pthread_create(&watcher, NULL, watch_snapshot, NULL);
+    for (i = 0; i < threads; i++) {
+        pthread_join(ids[i], NULL);
+    }
+    running = 0;
+    pthread_join(watcher, NULL);
+    close(shared_fd);
+    free(ids);
+
+    printf("%d threads, %d failures\n", threads, failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
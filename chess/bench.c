@@ -0,0 +1,87 @@
+#include "engine.h"
+
+// times perft, the evaluation, and fixed depth searches of the engine core outside the kernel
+// usage: ./chess_bench [perft depth] [search depth] [search threads]
+
+#define KIWIPETE "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
+
+#define EVAL_ITERATIONS 1000000
+
+static const char *const positions[] = { START_FEN, KIWIPETE, "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1" };
+
+static void bench_perft(const char *fen, int depth) {
+    static struct position pos;
+    static struct move_list lists[MAX_PLY];
+    u64 start, nanoseconds, nodes;
+
+    load_fen(&pos, fen);
+    start = ktime_get_ns();
+    nodes = perft(&pos, depth, lists);
+    nanoseconds = ktime_get_ns() - start;
+    printf("perft  depth %d: %12llu nodes %10.3f ms %8.2f Mnps  %s\n", depth, (unsigned long long)nodes,
+           nanoseconds / 1e6, nanoseconds ? nodes * 1e3 / nanoseconds : 0.0, fen);
+}
+
+static void bench_evaluate(const char *fen) {
+    static struct position pos;
+    volatile int score = 0;
+    u64 start, nanoseconds;
+    int i;
+
+    load_fen(&pos, fen);
+    start = ktime_get_ns();
+    for (i = 0; i < EVAL_ITERATIONS; i++) {
+        score += evaluate(&pos);
+    }
+    nanoseconds = ktime_get_ns() - start;
+    printf("eval   score %5d: %8.1f ns per call  %s\n", evaluate(&pos), (double)nanoseconds / EVAL_ITERATIONS, fen);
+}
+
+static void bench_search(struct search_workspace *workspace, const char *fen, int depth) {
+    static struct position pos;
+    struct move_list list;
+    struct search_stats stats;
+    bool cancel = false;
+    u16 move;
+
+    load_fen(&pos, fen);
+    generate_legal(&pos, &list);
+    move = search_best_move(workspace, &pos, NULL, &list, depth, MAX_SEARCH_TIME_MS, &cancel, &stats);
+    printf("search depth %d: move %c%d-%c%d %10llu nodes %9llu cutoffs %10.3f ms %8.2f Mnps  %s\n", depth,
+           'a' + SQ_COL(MOVE_FROM(move)), SQ_ROW(MOVE_FROM(move)) + 1, 'a' + SQ_COL(MOVE_TO(move)),
+           SQ_ROW(MOVE_TO(move)) + 1, (unsigned long long)stats.nodes, (unsigned long long)stats.cutoffs,
+           stats.nanoseconds / 1e6, stats.nanoseconds ? stats.nodes * 1e3 / stats.nanoseconds : 0.0, fen);
+}
+
+int main(int argc, char *argv[]) {
+    int perft_depth = argc > 1 ? atoi(argv[1]) : 4;
+    int search_depth = argc > 2 ? atoi(argv[2]) : 6;
+    int threads = argc > 3 ? atoi(argv[3]) : 1;
+    struct search_workspace *workspace;
+    size_t i;
+
+    engine_init();
+    if (tt_allocate(16)) {
+        printf("could not allocate the transposition table\n");
+        return EXIT_FAILURE;
+    }
+    search_set_threads(threads);
+    workspace = search_workspace_alloc();
+    if (!workspace) {
+        printf("could not allocate the search workspace\n");
+        tt_free();
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+        bench_perft(positions[i], perft_depth);
+    }
+    for (i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+        bench_evaluate(positions[i]);
+    }
+    for (i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+        bench_search(workspace, positions[i], search_depth);
+    }
+    search_workspace_free(workspace);
+    tt_free();
+    return EXIT_SUCCESS;
+}
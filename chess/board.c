@@ -0,0 +1,636 @@
+/*
+description: positions: setting them up from FEN, rendering them, attack tables, and making and unmaking moves
+*/
+#include "engine.h"
+
+// variables
+u64 between_mask[NUM_SQUARES][NUM_SQUARES]; // squares strictly between two aligned squares
+static u8 castling_kept[NUM_SQUARES]; // castling rights that survive a move from or to each square
+u64 knight_attacks[NUM_SQUARES];
+u64 king_attacks[NUM_SQUARES];
+u64 pawn_attacks[2][NUM_SQUARES]; // squares attacked by a pawn of each color
+struct magic rook_magics[NUM_SQUARES];
+struct magic bishop_magics[NUM_SQUARES];
+static u64 rook_table[102400];  // sum over all squares of 2^(relevant rook occupancy bits)
+static u64 bishop_table[5248];  // sum over all squares of 2^(relevant bishop occupancy bits)
+static u64 zobrist_pieces[NUM_PIECES][NUM_SQUARES];
+static u64 zobrist_side;
+static u64 zobrist_castling[CASTLE_ALL + 1];
+static u64 zobrist_ep[BOARD_SIZE]; // keyed by the file of the en passant square
+const char color_chars[] = "WB";
+const char type_chars[] = "PNBRQK";
+const char fen_chars[] = "PNBRQKpnbrqk";
+
+// place a piece on an empty square
+static void put_piece(struct position *pos, int piece, int sq) {
+    u64 bit = BIT_ULL(sq);
+    pos->pieces[piece] |= bit;
+    pos->occupied[PIECE_COLOR(piece)] |= bit;
+    pos->all |= bit;
+    pos->board[sq] = piece;
+    pos->key ^= zobrist_pieces[piece][sq];
+    pos->material += PIECE_COLOR(piece) == WHITE ? piece_values[PIECE_TYPE(piece)] : -piece_values[PIECE_TYPE(piece)];
+    pos->placement[PHASE_MG] += piece_square[PHASE_MG][piece][sq];
+    pos->placement[PHASE_EG] += piece_square[PHASE_EG][piece][sq];
+    pos->phase += phase_weights[PIECE_TYPE(piece)];
+    if (PIECE_TYPE(piece) == KING) {
+        pos->king_sq[PIECE_COLOR(piece)] = sq;
+    }
+}
+
+// remove whatever piece is on an occupied square
+static void remove_piece(struct position *pos, int sq) {
+    u64 bit = BIT_ULL(sq);
+    int piece = pos->board[sq];
+    pos->pieces[piece] &= ~bit;
+    pos->occupied[PIECE_COLOR(piece)] &= ~bit;
+    pos->all &= ~bit;
+    pos->board[sq] = NO_PIECE;
+    pos->key ^= zobrist_pieces[piece][sq];
+    pos->material -= PIECE_COLOR(piece) == WHITE ? piece_values[PIECE_TYPE(piece)] : -piece_values[PIECE_TYPE(piece)];
+    pos->placement[PHASE_MG] -= piece_square[PHASE_MG][piece][sq];
+    pos->placement[PHASE_EG] -= piece_square[PHASE_EG][piece][sq];
+    pos->phase -= phase_weights[PIECE_TYPE(piece)];
+}
+
+// converts a two character piece code such as "WP" into a piece index, returns -1 when invalid
+int parse_piece(const char *code) {
+    const char *type;
+    if (code[0] != 'W' && code[0] != 'B') {
+        return -1;
+    }
+    type = strchr(type_chars, code[1]);
+    if (code[1] == '\0' || type == NULL) {
+        return -1;
+    }
+    return MAKE_PIECE(code[0] == 'W' ? WHITE : BLACK, type - type_chars);
+}
+
+// writes the two character code of the piece on a square, "**" when it is empty
+static void piece_code(const struct position *pos, int sq, char *code) {
+    int piece = pos->board[sq];
+    if (piece == NO_PIECE) {
+        code[0] = EMPTY[0];
+        code[1] = EMPTY[1];
+    } else {
+        code[0] = color_chars[PIECE_COLOR(piece)];
+        code[1] = type_chars[PIECE_TYPE(piece)];
+    }
+}
+
+// precompute the squares between every pair of squares sharing a rank, file, or diagonal
+static void initialize_masks(void) {
+    int from, to, row_step, col_step, row, col;
+    for (from = 0; from < NUM_SQUARES; from++) {
+        for (to = 0; to < NUM_SQUARES; to++) {
+            int row_diff = SQ_ROW(to) - SQ_ROW(from);
+            int col_diff = SQ_COL(to) - SQ_COL(from);
+            between_mask[from][to] = 0;
+            if (from == to || (row_diff != 0 && col_diff != 0 && abs(row_diff) != abs(col_diff))) {
+                continue; // squares are not aligned
+            }
+            row_step = (row_diff > 0) - (row_diff < 0);
+            col_step = (col_diff > 0) - (col_diff < 0);
+            row = SQ_ROW(from) + row_step;
+            col = SQ_COL(from) + col_step;
+            while (SQUARE(row, col) != to) {
+                between_mask[from][to] |= BIT_ULL(SQUARE(row, col));
+                row += row_step;
+                col += col_step;
+            }
+        }
+    }
+
+    // moving a king or rook, or capturing a rook, loses the rights of that piece
+    memset(castling_kept, CASTLE_ALL, sizeof(castling_kept));
+    castling_kept[SQUARE(0, 4)] &= ~(CASTLE_WHITE_KING | CASTLE_WHITE_QUEEN);
+    castling_kept[SQUARE(0, 7)] &= ~CASTLE_WHITE_KING;
+    castling_kept[SQUARE(0, 0)] &= ~CASTLE_WHITE_QUEEN;
+    castling_kept[SQUARE(7, 4)] &= ~(CASTLE_BLACK_KING | CASTLE_BLACK_QUEEN);
+    castling_kept[SQUARE(7, 7)] &= ~CASTLE_BLACK_KING;
+    castling_kept[SQUARE(7, 0)] &= ~CASTLE_BLACK_QUEEN;
+}
+
+// king and rook squares each castling right needs, in the order of the FEN letters "KQkq"
+static const char castle_chars[] = "KQkq";
+static const int castle_king_sq[4] = { SQUARE(0, 4), SQUARE(0, 4), SQUARE(7, 4), SQUARE(7, 4) };
+static const int castle_rook_sq[4] = { SQUARE(0, 7), SQUARE(0, 0), SQUARE(7, 7), SQUARE(7, 0) };
+
+// the en passant square is part of the key only when a pawn of the side to move stands ready to take on it,
+// otherwise the position is the same as one without it and has to repeat it
+static u64 ep_key(const struct position *pos) {
+    if (pos->ep_square == NO_SQUARE ||
+        !(pawn_attacks[!pos->side][pos->ep_square] & pos->pieces[MAKE_PIECE(pos->side, PAWN)])) {
+        return 0;
+    }
+    return zobrist_ep[SQ_COL(pos->ep_square)];
+}
+
+// function to set up a position from FEN, the halfmove clock and fullmove number may be left out
+// a malformed FEN returns -EINVAL before the position is touched, the caller checks what needs attack tables
+int load_fen(struct position *pos, const char *fen) {
+    u8 board[NUM_SQUARES];
+    int kings[2] = { 0, 0 }, count[2] = { 0, 0 };
+    int row = BOARD_SIZE - 1, col = 0, side, castling = 0, ep_square = NO_SQUARE, right, sq, length;
+    unsigned int halfmove_clock = 0, fullmove_number = 1;
+    const char *p, *c;
+
+    // piece placement from rank 8 down to rank 1
+    memset(board, NO_PIECE, sizeof(board));
+    for (p = fen; *p && *p != ' '; p++) {
+        if (*p == '/') {
+            if (col != BOARD_SIZE || row == 0) {
+                return -EINVAL;
+            }
+            row--;
+            col = 0;
+        } 
+        else if (*p >= '1' && *p <= '8') {
+            col += *p - '0';
+            if (col > BOARD_SIZE) {
+                return -EINVAL;
+            }
+        } 
+        else if ((c = strchr(fen_chars, *p)) && col < BOARD_SIZE) {
+            int piece = c - fen_chars;
+            // pawns never stand on the first or last rank
+            if (PIECE_TYPE(piece) == PAWN && (row == 0 || row == BOARD_SIZE - 1)) {
+                return -EINVAL;
+            }
+            board[SQUARE(row, col++)] = piece;
+            kings[PIECE_COLOR(piece)] += PIECE_TYPE(piece) == KING;
+            count[PIECE_COLOR(piece)]++;
+        } 
+        else {
+            return -EINVAL;
+        }
+    }
+    if (row != 0 || col != BOARD_SIZE || kings[WHITE] != 1 || kings[BLACK] != 1 || count[WHITE] > 16 || count[BLACK] > 16) {
+        return -EINVAL;
+    }
+
+    // side to move
+    if (p[0] != ' ' || (p[1] != 'w' && p[1] != 'b')) {
+        return -EINVAL;
+    }
+    side = p[1] == 'w' ? WHITE : BLACK;
+    p += 2;
+
+    // castling rights, each one needs its king and rook on their starting squares
+    if (*p++ != ' ') {
+        return -EINVAL;
+    }
+    if (*p == '-') {
+        p++;
+    } 
+    else if (*p == ' ' || *p == '\0') {
+        return -EINVAL; // no rights are written as "-", never as an empty field
+    } 
+    else {
+        for (; *p && *p != ' '; p++) {
+            c = strchr(castle_chars, *p);
+            if (!c) {
+                return -EINVAL;
+            }
+            right = c - castle_chars;
+            if ((castling & BIT(right)) || board[castle_king_sq[right]] != MAKE_PIECE(right / 2, KING) ||
+                board[castle_rook_sq[right]] != MAKE_PIECE(right / 2, ROOK)) {
+                return -EINVAL;
+            }
+            castling |= BIT(right);
+        }
+    }
+
+    // en passant square, behind a pawn of the other side that has just made a double push
+    if (*p++ != ' ') {
+        return -EINVAL;
+    }
+    if (*p == '-') {
+        p++;
+    } 
+    else {
+        if (p[0] < 'a' || p[0] > 'h' || p[1] != (side == WHITE ? '6' : '3')) {
+            return -EINVAL;
+        }
+        ep_square = SQUARE(p[1] - '1', p[0] - 'a');
+        sq = side == WHITE ? ep_square - BOARD_SIZE : ep_square + BOARD_SIZE;
+        if (board[sq] != MAKE_PIECE(!side, PAWN) || board[ep_square] != NO_PIECE ||
+            board[side == WHITE ? ep_square + BOARD_SIZE : ep_square - BOARD_SIZE] != NO_PIECE) {
+            return -EINVAL;
+        }
+        p += 2;
+    }
+
+    // halfmove clock and fullmove number
+    if (*p) {
+        if (sscanf(p, " %u %u%n", &halfmove_clock, &fullmove_number, &length) != 2 || p[length] != '\0' ||
+            halfmove_clock > U16_MAX || fullmove_number < 1 || fullmove_number > U16_MAX) {
+            return -EINVAL;
+        }
+    }
+
+    // the text is valid, so build the position
+    memset(pos, 0, sizeof(*pos));
+    memset(pos->board, NO_PIECE, sizeof(pos->board));
+    for (sq = 0; sq < NUM_SQUARES; sq++) {
+        if (board[sq] != NO_PIECE) {
+            put_piece(pos, board[sq], sq);
+        }
+    }
+    pos->side = side;
+    if (side == BLACK) {
+        pos->key ^= zobrist_side;
+    }
+    pos->castling = castling;
+    pos->key ^= zobrist_castling[castling];
+    pos->ep_square = ep_square;
+    pos->key ^= ep_key(pos);
+    pos->halfmove_clock = halfmove_clock;
+    pos->fullmove_number = fullmove_number;
+    return 0;
+}
+
+// initialize the chess board
+void initialize_board(struct position *pos) {
+    // the start position is always valid
+    load_fen(pos, START_FEN);
+}
+
+// writes the piece placement field of FEN, rank 8 first
+static void write_placement(const struct position *pos, struct seq_buf *out) {
+    int row, col, empty;
+
+    for (row = BOARD_SIZE - 1; row >= 0; row--) {
+        empty = 0;
+        for (col = 0; col < BOARD_SIZE; col++) {
+            int piece = pos->board[SQUARE(row, col)];
+            if (piece == NO_PIECE) {
+                empty++;
+                continue;
+            }
+            if (empty) {
+                seq_buf_putc(out, '0' + empty);
+                empty = 0;
+            }
+            seq_buf_putc(out, fen_chars[piece]);
+        }
+        if (empty) {
+            seq_buf_putc(out, '0' + empty);
+        }
+        if (row > 0) {
+            seq_buf_putc(out, '/');
+        }
+    }
+}
+
+// renders the board in one pass in the given display mode
+void display_board(const struct position *pos, int mode, struct seq_buf *out) {
+    int i, j;
+
+    // a single line with the placement and the side to move
+    if (mode == DISPLAY_COMPACT) {
+        write_placement(pos, out);
+        seq_buf_printf(out, " %c\n", pos->side == WHITE ? 'w' : 'b');
+        return;
+    }
+
+    for (i = 0; i < BOARD_SIZE; i++) {
+        seq_buf_putc(out, '1' + i);
+        seq_buf_putc(out, ' ');
+
+        for (j = 0; j < BOARD_SIZE; j++) {
+            int piece = pos->board[SQUARE(i, j)];
+            char code[2];
+            piece_code(pos, SQUARE(i, j), code);
+            // color the piece based on player color
+            if (mode == DISPLAY_COLOR && piece != NO_PIECE) {
+                seq_buf_puts(out, PIECE_COLOR(piece) == WHITE ? "\033[1;31m" : "\033[0;34m");
+            }
+            seq_buf_putmem(out, code, 2);
+            if (mode == DISPLAY_COLOR) {
+                seq_buf_puts(out, "\033[0m"); // reset color
+            }
+            seq_buf_putc(out, ' ');
+        }
+        seq_buf_putc(out, '\n');
+    }
+    // append column numbers
+    seq_buf_puts(out, "  a  b  c  d  e  f  g  h\n");
+}
+
+// writes the position as a FEN line
+void write_fen(const struct position *pos, struct seq_buf *out) {
+    int right;
+
+    write_placement(pos, out);
+    seq_buf_printf(out, " %c ", pos->side == WHITE ? 'w' : 'b');
+    if (!pos->castling) {
+        seq_buf_putc(out, '-');
+    }
+    for (right = 0; right < 4; right++) {
+        if (pos->castling & BIT(right)) {
+            seq_buf_putc(out, castle_chars[right]);
+        }
+    }
+    if (pos->ep_square == NO_SQUARE) {
+        seq_buf_puts(out, " -");
+    } 
+    else {
+        seq_buf_printf(out, " %c%c", 'a' + SQ_COL(pos->ep_square), '1' + SQ_ROW(pos->ep_square));
+    }
+    seq_buf_printf(out, " %d %d\n", pos->halfmove_clock, pos->fullmove_number);
+}
+
+// write a packed move as its origin and destination like e2e4, with the promoted piece appended like e7e8q
+void write_move(u16 move, struct seq_buf *out) {
+    int from = MOVE_FROM(move), to = MOVE_TO(move);
+
+    seq_buf_printf(out, "%c%d%c%d", 'a' + SQ_COL(from), SQ_ROW(from) + 1, 'a' + SQ_COL(to), SQ_ROW(to) + 1);
+    if (MOVE_FLAGS(move) & MOVE_PROMOTION) {
+        seq_buf_putc(out, fen_chars[MAKE_PIECE(BLACK, MOVE_PROMOTED(move))]);
+    }
+}
+
+// squares a knight on sq attacks, used to fill the attack tables
+static u64 __init knight_targets(int sq) {
+    u64 bit = BIT_ULL(sq);
+    u64 one = ((bit << 1) & ~FILE_A) | ((bit >> 1) & ~FILE_H);
+    u64 two = ((bit << 2) & ~(FILE_A | FILE_B)) | ((bit >> 2) & ~(FILE_G | FILE_H));
+    return (one << 16) | (one >> 16) | (two << 8) | (two >> 8);
+}
+
+// squares a king on sq attacks, used to fill the attack tables
+static u64 __init king_targets(int sq) {
+    u64 bit = BIT_ULL(sq);
+    u64 row = bit | ((bit << 1) & ~FILE_A) | ((bit >> 1) & ~FILE_H);
+    return (row | (row << 8) | (row >> 8)) & ~bit;
+}
+
+// squares a sliding piece on sq attacks along its directions, walking each ray until it hits an occupied square
+static u64 __init slider_targets(int sq, u64 occupied, const int directions[][2]) {
+    u64 targets = 0;
+    int i, row, col;
+    for (i = 0; i < 4; i++) {
+        row = SQ_ROW(sq) + directions[i][0];
+        col = SQ_COL(sq) + directions[i][1];
+        while (row >= 0 && row < BOARD_SIZE && col >= 0 && col < BOARD_SIZE) {
+            targets |= BIT_ULL(SQUARE(row, col));
+            if (occupied & BIT_ULL(SQUARE(row, col))) {
+                break; // ray is blocked
+            }
+            row += directions[i][0];
+            col += directions[i][1];
+        }
+    }
+    return targets;
+}
+
+// xorshift pseudo random numbers, seeded so the tables are the same on every load
+static u64 __init random64(u64 *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+// sparse random numbers make good magic candidates
+static u64 __init magic_candidate(u64 *state) {
+    return random64(state) & random64(state) & random64(state);
+}
+
+// find a magic multiplier for every square and fill its slice of the shared attack table
+static void __init initialize_magics(struct magic *magics, u64 *table, const int directions[][2]) {
+    static u64 occupancy[4096] __initdata;
+    static u64 reference[4096] __initdata;
+    static int epoch[4096] __initdata;
+    static const u64 seeds[BOARD_SIZE] __initconst = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+    u64 state;
+    u64 edges, occupied;
+    int sq, size, i, attempt;
+
+    for (sq = 0; sq < NUM_SQUARES; sq++) {
+        struct magic *m = &magics[sq];
+
+        // pieces on the board edge never block a ray, unless the slider itself is on that edge
+        edges = ((RANK_1 | RANK_8) & ~(RANK_1 << (8 * SQ_ROW(sq)))) |
+                ((FILE_A | FILE_H) & ~(FILE_A << SQ_COL(sq)));
+        m->mask = slider_targets(sq, 0, directions) & ~edges;
+        m->shift = 64 - hweight64(m->mask);
+        m->attacks = table;
+
+        // enumerate every subset of the mask with the carry-rippler trick
+        size = 0;
+        occupied = 0;
+        do {
+            occupancy[size] = occupied;
+            reference[size] = slider_targets(sq, occupied, directions);
+            size++;
+            occupied = (occupied - m->mask) & m->mask;
+        } while (occupied);
+
+        // try candidates until one maps every subset to a slot without a destructive collision
+        memset(epoch, 0, sizeof(epoch));
+        state = seeds[SQ_ROW(sq)];
+        for (attempt = 1;; attempt++) {
+            do {
+                m->magic = magic_candidate(&state);
+            } while (hweight64((m->mask * m->magic) >> 56) < 6);
+
+            for (i = 0; i < size; i++) {
+                unsigned int index = (occupancy[i] * m->magic) >> m->shift;
+                if (epoch[index] < attempt) {
+                    epoch[index] = attempt;
+                    m->attacks[index] = reference[i];
+                } else if (m->attacks[index] != reference[i]) {
+                    break;
+                }
+            }
+            if (i == size) {
+                break;
+            }
+        }
+        table += size;
+    }
+}
+
+// fill the leaper tables and the magic slider tables
+static void __init initialize_attacks(void) {
+    static const int straight[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+    static const int diagonal[4][2] = { { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+    int sq;
+
+    for (sq = 0; sq < NUM_SQUARES; sq++) {
+        u64 bit = BIT_ULL(sq);
+        knight_attacks[sq] = knight_targets(sq);
+        king_attacks[sq] = king_targets(sq);
+        pawn_attacks[WHITE][sq] = ((bit & ~FILE_A) << 7) | ((bit & ~FILE_H) << 9);
+        pawn_attacks[BLACK][sq] = ((bit & ~FILE_H) >> 7) | ((bit & ~FILE_A) >> 9);
+    }
+    initialize_magics(rook_magics, rook_table, straight);
+    initialize_magics(bishop_magics, bishop_table, diagonal);
+}
+
+// fill the zobrist keys that are xored into a position's hash
+static void __init initialize_zobrist(void) {
+    u64 state = 1070372;
+    int piece, sq;
+    for (piece = 0; piece < NUM_PIECES; piece++) {
+        for (sq = 0; sq < NUM_SQUARES; sq++) {
+            zobrist_pieces[piece][sq] = random64(&state);
+        }
+    }
+    zobrist_side = random64(&state);
+    // no rights hash to zero, so positions without castling or en passant keep the keys of the pieces alone
+    for (sq = 1; sq <= CASTLE_ALL; sq++) {
+        zobrist_castling[sq] = random64(&state);
+    }
+    for (sq = 0; sq < BOARD_SIZE; sq++) {
+        zobrist_ep[sq] = random64(&state);
+    }
+}
+
+// determines if any piece of the given color attacks a square
+bool square_attacked_by(const struct position *pos, int color, int sq) {
+    const u64 *pieces = &pos->pieces[MAKE_PIECE(color, PAWN)];
+    return (pawn_attacks[!color][sq] & pieces[PAWN]) ||
+           (knight_attacks[sq] & pieces[KNIGHT]) ||
+           (king_attacks[sq] & pieces[KING]) ||
+           (bishop_attacks(sq, pos->all) & (pieces[BISHOP] | pieces[QUEEN])) ||
+           (rook_attacks(sq, pos->all) & (pieces[ROOK] | pieces[QUEEN]));
+}
+
+// every piece of either color attacking a square, with sliders seen through the given occupancy
+u64 attackers_to(const struct position *pos, int sq, u64 occupied) {
+    const u64 *pieces = pos->pieces;
+    u64 diagonal = pieces[MAKE_PIECE(WHITE, BISHOP)] | pieces[MAKE_PIECE(BLACK, BISHOP)] |
+                   pieces[MAKE_PIECE(WHITE, QUEEN)] | pieces[MAKE_PIECE(BLACK, QUEEN)];
+    u64 straight = pieces[MAKE_PIECE(WHITE, ROOK)] | pieces[MAKE_PIECE(BLACK, ROOK)] |
+                   pieces[MAKE_PIECE(WHITE, QUEEN)] | pieces[MAKE_PIECE(BLACK, QUEEN)];
+
+    return (pawn_attacks[BLACK][sq] & pieces[MAKE_PIECE(WHITE, PAWN)]) |
+           (pawn_attacks[WHITE][sq] & pieces[MAKE_PIECE(BLACK, PAWN)]) |
+           (knight_attacks[sq] & (pieces[MAKE_PIECE(WHITE, KNIGHT)] | pieces[MAKE_PIECE(BLACK, KNIGHT)])) |
+           (king_attacks[sq] & (pieces[MAKE_PIECE(WHITE, KING)] | pieces[MAKE_PIECE(BLACK, KING)])) |
+           (bishop_attacks(sq, occupied) & diagonal) | (rook_attacks(sq, occupied) & straight);
+}
+
+// square of the pawn an en passant capture by the side to move takes, beside the destination
+static int en_passant_victim(const struct position *pos, int to) {
+    return pos->side == WHITE ? to - BOARD_SIZE : to + BOARD_SIZE;
+}
+
+// squares a castling rook moves from and to, the rook lands on the square the king crosses
+static void castling_rook(int from, int to, int flags, int *rook_from, int *rook_to) {
+    *rook_from = flags == MOVE_KING_CASTLE ? to + 1 : to - 2;
+    *rook_to = (from + to) / 2;
+}
+
+// plays a packed move on a position and passes the turn, saving what unmake_move() needs to take it back
+void make_move(struct position *pos, u16 move) {
+    struct undo *undo = &pos->undo_stack[pos->ply++];
+    int from = MOVE_FROM(move);
+    int to = MOVE_TO(move);
+    int flags = MOVE_FLAGS(move);
+    int piece = pos->board[from];
+    int captured_sq = flags == MOVE_EN_PASSANT ? en_passant_victim(pos, to) : to;
+    int rook_from, rook_to;
+
+    undo->key = pos->key;
+    undo->move = move;
+    undo->captured = pos->board[captured_sq];
+    undo->castling = pos->castling;
+    undo->ep_square = pos->ep_square;
+    undo->halfmove_clock = pos->halfmove_clock;
+
+    pos->key ^= zobrist_castling[pos->castling];
+    pos->castling &= castling_kept[from] & castling_kept[to];
+    pos->key ^= zobrist_castling[pos->castling];
+    pos->key ^= ep_key(pos);
+    pos->ep_square = flags == MOVE_DOUBLE_PUSH ? (from + to) / 2 : NO_SQUARE;
+    pos->halfmove_clock++;
+    if (PIECE_TYPE(piece) == PAWN || undo->captured != NO_PIECE) {
+        pos->halfmove_clock = 0;
+    }
+    if (pos->side == BLACK) {
+        pos->fullmove_number++;
+    }
+
+    if (undo->captured != NO_PIECE) {
+        remove_piece(pos, captured_sq);
+    }
+    remove_piece(pos, from);
+    if (flags & MOVE_PROMOTION) {
+        piece = MAKE_PIECE(PIECE_COLOR(piece), MOVE_PROMOTED(move));
+    }
+    put_piece(pos, piece, to);
+    if (flags == MOVE_KING_CASTLE || flags == MOVE_QUEEN_CASTLE) {
+        castling_rook(from, to, flags, &rook_from, &rook_to);
+        remove_piece(pos, rook_from);
+        put_piece(pos, MAKE_PIECE(pos->side, ROOK), rook_to);
+    }
+    pos->side ^= 1;
+    pos->key ^= zobrist_side ^ ep_key(pos);
+}
+
+// takes back the last move made on a position
+void unmake_move(struct position *pos) {
+    struct undo *undo = &pos->undo_stack[--pos->ply];
+    int from = MOVE_FROM(undo->move);
+    int to = MOVE_TO(undo->move);
+    int flags = MOVE_FLAGS(undo->move);
+    int piece = pos->board[to];
+    int rook_from, rook_to;
+
+    pos->side ^= 1;
+    if (flags == MOVE_KING_CASTLE || flags == MOVE_QUEEN_CASTLE) {
+        castling_rook(from, to, flags, &rook_from, &rook_to);
+        remove_piece(pos, rook_to);
+        put_piece(pos, MAKE_PIECE(pos->side, ROOK), rook_from);
+    }
+    remove_piece(pos, to);
+    if (flags & MOVE_PROMOTION) {
+        piece = MAKE_PIECE(pos->side, PAWN);
+    }
+    put_piece(pos, piece, from);
+    if (undo->captured != NO_PIECE) {
+        put_piece(pos, undo->captured, flags == MOVE_EN_PASSANT ? en_passant_victim(pos, to) : to);
+    }
+    pos->key = undo->key;
+    pos->castling = undo->castling;
+    pos->ep_square = undo->ep_square;
+    pos->halfmove_clock = undo->halfmove_clock;
+    if (pos->side == BLACK) {
+        pos->fullmove_number--;
+    }
+}
+
+// determines if neither side has the material left to mate: only kings, a single minor piece,
+// or bishops that all stand on squares of one color
+bool insufficient_material(const struct position *pos) {
+    const u64 *pieces = pos->pieces;
+    u64 knights = pieces[MAKE_PIECE(WHITE, KNIGHT)] | pieces[MAKE_PIECE(BLACK, KNIGHT)];
+    u64 bishops = pieces[MAKE_PIECE(WHITE, BISHOP)] | pieces[MAKE_PIECE(BLACK, BISHOP)];
+    u64 kings = pieces[MAKE_PIECE(WHITE, KING)] | pieces[MAKE_PIECE(BLACK, KING)];
+
+    if (pos->all != (kings | knights | bishops)) {
+        return false; // a pawn, rook, or queen can always mate
+    }
+    if (hweight64(knights | bishops) <= 1) {
+        return true;
+    }
+    return !knights && (!(bishops & LIGHT_SQUARES) || !(bishops & ~LIGHT_SQUARES));
+}
+
+// plays a move for good, its undo record is dropped since games are not taken back
+void commit_move(struct position *pos, u16 move) {
+    make_move(pos, move);
+    pos->ply--;
+}
+
+// fill every table the engine reads, must run once before any position is set up
+void __init engine_init(void) {
+    initialize_masks();
+    initialize_attacks();
+    initialize_zobrist();
+    initialize_eval();
+}
@@ -0,0 +1,268 @@
+/*
+description: the kernel facilities the engine core uses, taken from linux/ in the module and from libc in user space
+*/
+#ifndef CHESS_COMPAT_H
+#define CHESS_COMPAT_H
+
+#ifdef __KERNEL__
+
+#include <linux/init.h>
+#include <linux/bitops.h>
+#include <linux/types.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/errno.h>
+#include <linux/ktime.h>
+#include <linux/sched.h>
+#include <linux/vmalloc.h>
+#include <linux/atomic.h>
+#include <linux/log2.h>
+#include <linux/math64.h>
+#include <linux/seq_buf.h>
+#include <linux/slab.h>
+#include <linux/kthread.h>
+#include <linux/completion.h>
+#include <linux/err.h>
+#include <linux/random.h>
+#include <asm/barrier.h>
+
+#else
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+typedef uint64_t u64;
+typedef uint32_t u32;
+typedef uint16_t u16;
+typedef uint8_t u8;
+typedef int16_t s16;
+
+#define BIT(n) (1UL << (n))
+#define BIT_ULL(n) (1ULL << (n))
+#define U16_MAX 0xffff
+#define ARRAY_SIZE(arr) (sizeof(arr) / sizeof((arr)[0]))
+#define NSEC_PER_MSEC 1000000ULL
+#define NSEC_PER_SEC 1000000000ULL
+
+// memory that is only used while the module loads
+#define __init
+#define __initdata
+#define __initconst
+
+#define READ_ONCE(x) (*(const volatile __typeof__(x) *)&(x))
+#define WRITE_ONCE(x, val) (*(volatile __typeof__(x) *)&(x) = (val))
+#define smp_store_release(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define smp_load_acquire(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+
+#define fallthrough __attribute__((__fallthrough__))
+
+// a userspace thread is preempted anyway
+#define cond_resched() do { } while (0)
+
+static inline unsigned long __ffs64(u64 word) {
+    return __builtin_ctzll(word);
+}
+
+static inline unsigned int hweight64(u64 word) {
+    return __builtin_popcountll(word);
+}
+
+static inline u64 rounddown_pow_of_two(u64 n) {
+    return n ? 1ULL << (63 - __builtin_clzll(n)) : 0;
+}
+
+static inline u64 div64_u64(u64 dividend, u64 divisor) {
+    return dividend / divisor;
+}
+
+static inline u64 ktime_get_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (u64)now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
+
+static inline void *vzalloc(size_t size) {
+    return calloc(1, size);
+}
+
+static inline void vfree(const void *addr) {
+    free((void *)addr);
+}
+
+#define GFP_KERNEL 0
+
+static inline void *kzalloc(size_t size, int flags) {
+    (void)flags;
+    return calloc(1, size);
+}
+
+static inline void *kcalloc(size_t n, size_t size, int flags) {
+    (void)flags;
+    return calloc(n, size);
+}
+
+static inline void kfree(const void *addr) {
+    free((void *)addr);
+}
+
+typedef struct {
+    long long counter;
+} atomic64_t;
+
+#define ATOMIC64_INIT(i) { (i) }
+
+static inline void atomic64_add(long long i, atomic64_t *v) {
+    __atomic_fetch_add(&v->counter, i, __ATOMIC_RELAXED);
+}
+
+static inline long long atomic64_read(const atomic64_t *v) {
+    return __atomic_load_n(&v->counter, __ATOMIC_RELAXED);
+}
+
+// not for anything secret, like the kernel's it only has to spread choices
+static inline u32 get_random_u32_below(u32 ceil) {
+    return (u32)random() % ceil;
+}
+
+#define MAX_ERRNO 4095
+#define IS_ERR(ptr) ((unsigned long)(ptr) >= (unsigned long)-MAX_ERRNO)
+
+static inline void *ERR_PTR(long error) {
+    return (void *)error;
+}
+
+// signals the end of a thread's work, waited for once
+struct completion {
+    pthread_mutex_t lock;
+    pthread_cond_t wait;
+    bool done;
+};
+
+static inline void init_completion(struct completion *x) {
+    pthread_mutex_init(&x->lock, NULL);
+    pthread_cond_init(&x->wait, NULL);
+    x->done = false;
+}
+
+static inline void complete(struct completion *x) {
+    pthread_mutex_lock(&x->lock);
+    x->done = true;
+    pthread_cond_broadcast(&x->wait);
+    pthread_mutex_unlock(&x->lock);
+}
+
+static inline void wait_for_completion(struct completion *x) {
+    pthread_mutex_lock(&x->lock);
+    while (!x->done) {
+        pthread_cond_wait(&x->wait, &x->lock);
+    }
+    pthread_mutex_unlock(&x->lock);
+}
+
+// kernel threads run as detached pthreads, the task belongs to the thread and is freed before its function runs
+struct task_struct {
+    int (*threadfn)(void *data);
+    void *data;
+};
+
+static inline void *kthread_trampoline(void *arg) {
+    struct task_struct task = *(struct task_struct *)arg;
+
+    free(arg);
+    task.threadfn(task.data);
+    return NULL;
+}
+
+static inline struct task_struct *kthread_start(int (*threadfn)(void *data), void *data) {
+    struct task_struct *task = malloc(sizeof(*task));
+    pthread_attr_t attr;
+    pthread_t thread;
+    int ret;
+
+    if (!task) {
+        return ERR_PTR(-ENOMEM);
+    }
+    task->threadfn = threadfn;
+    task->data = data;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    ret = pthread_create(&thread, &attr, kthread_trampoline, task);
+    pthread_attr_destroy(&attr);
+    if (ret) {
+        free(task);
+        return ERR_PTR(-ret);
+    }
+    return task;
+}
+
+#define kthread_run(threadfn, data, namefmt, ...) kthread_start(threadfn, data)
+
+static inline void __attribute__((noreturn)) kthread_complete_and_exit(struct completion *comp, long code) {
+    (void)code;
+    complete(comp);
+    pthread_exit(NULL);
+}
+
+// bounded output buffer with the subset of the kernel's seq_buf interface the renderers use
+struct seq_buf {
+    char *buffer;
+    size_t size;
+    size_t len; // size + 1 once something did not fit
+};
+
+static inline void seq_buf_init(struct seq_buf *s, char *buf, size_t size) {
+    s->buffer = buf;
+    s->size = size;
+    s->len = 0;
+}
+
+static inline size_t seq_buf_used(struct seq_buf *s) {
+    return s->len < s->size ? s->len : s->size;
+}
+
+static inline int seq_buf_putmem(struct seq_buf *s, const void *mem, size_t len) {
+    if (s->len + len > s->size) {
+        s->len = s->size + 1;
+        return -1;
+    }
+    memcpy(s->buffer + s->len, mem, len);
+    s->len += len;
+    return 0;
+}
+
+static inline int seq_buf_putc(struct seq_buf *s, unsigned char c) {
+    return seq_buf_putmem(s, &c, 1);
+}
+
+static inline int seq_buf_puts(struct seq_buf *s, const char *str) {
+    return seq_buf_putmem(s, str, strlen(str));
+}
+
+static inline __attribute__((format(printf, 2, 3))) int seq_buf_printf(struct seq_buf *s, const char *fmt, ...) {
+    va_list args;
+    int len = -1;
+
+    if (s->len < s->size) {
+        va_start(args, fmt);
+        len = vsnprintf(s->buffer + s->len, s->size - s->len, fmt, args);
+        va_end(args);
+    }
+    if (len < 0 || s->len + len >= s->size) {
+        s->len = s->size + 1;
+        return -1;
+    }
+    s->len += len;
+    return 0;
+}
+
+#endif
+
+#endif
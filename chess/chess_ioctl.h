@@ -0,0 +1,130 @@
+/*
+description: binary ioctl interface of /dev/chess, shared by the module and its clients
+*/
+#ifndef CHESS_IOCTL_H
+#define CHESS_IOCTL_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+// every structure starts with the version the client was built against, other versions are rejected
+#define CHESS_IOCTL_VERSION 1
+
+// colors and pieces, a piece is color * 6 + type and squares are numbered from a1 = 0 to h8 = 63
+#define CHESS_WHITE 0
+#define CHESS_BLACK 1
+#define CHESS_PAWN 0
+#define CHESS_KNIGHT 1
+#define CHESS_BISHOP 2
+#define CHESS_ROOK 3
+#define CHESS_QUEEN 4
+#define CHESS_KING 5
+#define CHESS_EMPTY 12
+
+// packed move: from square in bits 0-5, to square in bits 6-11, flags in bits 12-15
+#define CHESS_MOVE(from, to, flags) ((__u16)((from) | ((to) << 6) | ((flags) << 12)))
+#define CHESS_MOVE_FROM(move) ((move) & 0x3f)
+#define CHESS_MOVE_TO(move) (((move) >> 6) & 0x3f)
+#define CHESS_MOVE_FLAGS(move) ((move) >> 12)
+#define CHESS_MOVE_KING_CASTLE 2  // the king moves two squares toward the h-file rook, filled in by the module
+#define CHESS_MOVE_QUEEN_CASTLE 3 // the king moves two squares toward the a-file rook
+#define CHESS_MOVE_CAPTURE 4   // filled in by the module, submitted moves may leave it out
+#define CHESS_MOVE_EN_PASSANT 5   // a pawn capture of the pawn that just passed the destination
+#define CHESS_MOVE_PROMOTION 8 // the low two flag bits are the promotion type minus CHESS_KNIGHT
+
+// result of the last command, the text protocol prints the same results as words
+#define CHESS_RESULT_OK 0
+#define CHESS_RESULT_CHECK 1
+#define CHESS_RESULT_NOGAME 2
+#define CHESS_RESULT_OOT 3
+#define CHESS_RESULT_ILLMOVE 4
+#define CHESS_RESULT_UNKCMD 5
+#define CHESS_RESULT_INVFMT 6
+#define CHESS_RESULT_WHITE_MATES 7 // MATE, WHITE WINS
+#define CHESS_RESULT_BLACK_MATES 8 // MATE, BLACK WINS
+#define CHESS_RESULT_WHITE_WINS 9  // black resigned
+#define CHESS_RESULT_BLACK_WINS 10 // white resigned
+#define CHESS_RESULT_PENDING 11    // an asynchronous CPU move is being searched
+#define CHESS_RESULT_DRAW_REPETITION 12  // the same position occurred three times with the same side to move
+#define CHESS_RESULT_DRAW_FIFTY_MOVES 13 // fifty moves by each side without a capture or pawn move
+#define CHESS_RESULT_DRAW_STALEMATE 14   // the side to move has no legal move and is not in check
+#define CHESS_RESULT_DRAW_MATERIAL 15    // neither side has the pieces left to mate
+
+// game flags
+#define CHESS_FLAG_STARTED 0x01
+#define CHESS_FLAG_PLAYER_TURN 0x02
+#define CHESS_FLAG_PLAYER_BLACK 0x04
+#define CHESS_FLAG_BLACK_TO_MOVE 0x08
+#define CHESS_FLAG_CHECK 0x10 // the side to move is in check
+#define CHESS_FLAG_SEARCHING 0x20
+#define CHESS_FLAG_ASYNC 0x40
+
+struct chess_new_game {
+    __u32 version;
+    __u32 player_color; // CHESS_WHITE or CHESS_BLACK
+};
+
+struct chess_move {
+    __u32 version;
+    __u16 move;   // in for CHESS_IOC_MOVE, out for CHESS_IOC_CPU_MOVE
+    __u16 result; // out
+};
+
+struct chess_board {
+    __u32 version;
+    __u32 flags;        // out
+    __u8 squares[64];   // out, a piece or CHESS_EMPTY for every square
+};
+
+struct chess_status {
+    __u32 version;
+    __u32 flags;     // out
+    __u16 result;    // out, result of the last move, game, or setting command
+    __u16 last_move; // out, 0 before the first move
+};
+
+struct chess_perft {
+    __u32 version;
+    __u16 depth;  // in, from 1 to 7
+    __u16 result; // out, CHESS_RESULT_NOGAME if there is no position to count from
+    __u64 nodes;  // out, leaves of the legal move tree
+    __u64 nanoseconds;
+    __u64 nodes_per_second;
+};
+
+// moves of the game copied by CHESS_IOC_MOVE_LOG, a client tails the game by asking from first + count next time
+#define CHESS_MOVE_LOG_MAX 64
+struct chess_move_log {
+    __u32 version;
+    __u32 offset; // in, index of the first move wanted, the first move of the game is 0
+    __u32 first;  // out, index of moves[0], later than offset if the module no longer keeps the moves before it
+    __u32 count;  // out, moves copied
+    __u32 total;  // out, moves played in the game
+    __u16 moves[CHESS_MOVE_LOG_MAX]; // out, packed moves
+};
+
+// read-only page mapped with mmap() at offset 0, rewritten after every command and CPU move
+// sequence is odd while the page is being written, so a reader copies the fields between two equal even reads:
+//     do { seq = snapshot->sequence; read barrier; copy; read barrier; } while (seq & 1 || seq != snapshot->sequence);
+struct chess_snapshot {
+    __u32 sequence;
+    __u32 flags;        // CHESS_FLAG_*
+    __u32 move_count;   // moves played in this game by both sides
+    __u16 result;       // result of the last move, game, or setting command
+    __u16 last_move;    // 0 before the first move
+    __u8 side_to_move;  // CHESS_WHITE or CHESS_BLACK
+    __u8 reserved[3];
+    __u8 squares[64];   // a piece or CHESS_EMPTY for every square, a1 first
+};
+
+#define CHESS_IOC_MAGIC 'C'
+#define CHESS_IOC_NEW_GAME _IOW(CHESS_IOC_MAGIC, 0, struct chess_new_game)
+#define CHESS_IOC_MOVE _IOWR(CHESS_IOC_MAGIC, 1, struct chess_move)
+#define CHESS_IOC_CPU_MOVE _IOWR(CHESS_IOC_MAGIC, 2, struct chess_move)
+#define CHESS_IOC_GET_BOARD _IOWR(CHESS_IOC_MAGIC, 3, struct chess_board)
+#define CHESS_IOC_RESIGN _IOWR(CHESS_IOC_MAGIC, 4, struct chess_status)
+#define CHESS_IOC_STATUS _IOWR(CHESS_IOC_MAGIC, 5, struct chess_status)
+#define CHESS_IOC_PERFT _IOWR(CHESS_IOC_MAGIC, 6, struct chess_perft)
+#define CHESS_IOC_MOVE_LOG _IOWR(CHESS_IOC_MAGIC, 7, struct chess_move_log)
+
+#endif
@@ -0,0 +1,1142 @@
+/*
+author: Andrew Tang
+email: andrew73@umbc.edu
+description: a implementation of chess in a kernel module, this file holds the device and its commands, the engine lives in engine.h
+*/
+#include <linux/module.h>
+#include <linux/fs.h>
+#include <linux/miscdevice.h>
+#include <linux/slab.h>
+#include <linux/uaccess.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/wait.h>
+#include <linux/poll.h>
+#include <linux/mm.h>
+#include <linux/firmware.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+
+#include "engine.h"
+#include "chess_ioctl.h"
+#include "chess_stats.h"
+
+MODULE_LICENSE("GPL");
+
+// longest command a write may hold
+#define MAX_COMMAND_LEN 127
+
+// deepest perft a command may ask for, deeper ones run for minutes
+#define MAX_PERFT_DEPTH 7
+
+// text responses of the command results
+static const char *const result_messages[] = {
+    [CHESS_RESULT_OK] = "OK\n",
+    [CHESS_RESULT_CHECK] = "CHECK\n",
+    [CHESS_RESULT_NOGAME] = "NOGAME\n",
+    [CHESS_RESULT_OOT] = "OOT\n",
+    [CHESS_RESULT_ILLMOVE] = "ILLMOVE\n",
+    [CHESS_RESULT_UNKCMD] = "UNKCMD\n",
+    [CHESS_RESULT_INVFMT] = "INVFMT\n",
+    [CHESS_RESULT_WHITE_MATES] = "MATE\nWHITE WINS\n",
+    [CHESS_RESULT_BLACK_MATES] = "MATE\nBLACK WINS\n",
+    [CHESS_RESULT_WHITE_WINS] = "OK\nWHITE WINS\n",
+    [CHESS_RESULT_BLACK_WINS] = "OK\nBLACK WINS\n",
+    [CHESS_RESULT_PENDING] = "",
+    [CHESS_RESULT_DRAW_REPETITION] = "DRAW\nREPETITION\n",
+    [CHESS_RESULT_DRAW_FIFTY_MOVES] = "DRAW\nFIFTY MOVES\n",
+    [CHESS_RESULT_DRAW_STALEMATE] = "DRAW\nSTALEMATE\n",
+    [CHESS_RESULT_DRAW_MATERIAL] = "DRAW\nINSUFFICIENT MATERIAL\n",
+};
+
+#define DEV_NAME "chess"
+
+// one game, owned by an open file descriptor of the device
+struct chess_session {
+    struct mutex lock;  // held for a whole command or read so every response matches one command
+    struct position pos;
+    int player_color;
+    int cpu_color;
+    bool game_started;
+    bool player_turn;
+    int search_depth;   // difficulty as the maximum search depth in plies
+    int search_time_ms; // difficulty as the time budget of one CPU move
+    bool async;         // CPU moves are searched on the workqueue instead of inside the write
+    bool searching;     // a queued CPU move owns search_pos and the response until the worker is done
+    bool cancel_search; // asks the queued search to stop and drop its move
+    struct work_struct search_work;
+    wait_queue_head_t wait; // readers and pollers waiting for a queued CPU move
+    int result;             // CHESS_RESULT_* of the last move, game, or setting command
+    u16 last_move;
+    u32 move_count;         // moves played in this game by both sides
+    struct chess_snapshot *snapshot; // page mapped read-only by clients, see publish_snapshot()
+    struct position search_pos; // copy of the game searched by the worker without holding the lock
+    struct move_list search_root; // legal moves of the searched position, owned by the search like search_pos
+    struct search_stats search_stats; // counters of the last search, owned by the search like search_pos
+    bool book_move;         // the last CPU move came from the book, owned by the search like search_pos
+    struct search_workspace *workspace; // killers, history, and pickers of the search threads, owned by the search
+    struct move_list moves[MAX_PERFT_DEPTH]; // scratch lists of the commands, one per level of a perft
+    struct game_history history; // moves of the game, kept after it ends until the next one starts
+    int display_mode;       // DISPLAY_* format of the board shown by command 01
+    char output_message[1024]; // response to the last command, large enough for the colored board
+    struct game_stats stats;   // counters of the game, shown in debugfs
+    struct dentry *debugfs;    // the session's file in the debugfs games directory
+};
+
+// argument of any ioctl, all of them start with the interface version
+union chess_ioctl_arg {
+    __u32 version;
+    struct chess_new_game game;
+    struct chess_move move;
+    struct chess_board board;
+    struct chess_status status;
+    struct chess_perft perft;
+    struct chess_move_log log;
+};
+
+// variables
+static struct kmem_cache *session_cache;
+static struct workqueue_struct *search_wq; // runs the CPU move searches of sessions in async mode
+static atomic_t session_ids = ATOMIC_INIT(0); // names the debugfs files of the sessions
+
+// size of the transposition table, set when the module is loaded
+static unsigned int tt_size_mb = 16;
+module_param(tt_size_mb, uint, 0444);
+MODULE_PARM_DESC(tt_size_mb, "Transposition table size in MB, rounded down to a power of two, 0 disables it");
+
+static unsigned int search_threads = 1;
+module_param(search_threads, uint, 0444);
+MODULE_PARM_DESC(search_threads, "Threads searching each CPU move, from 1 to 64, sharing the transposition table");
+
+static char *book_file = "chess_book.bin";
+module_param(book_file, charp, 0444);
+MODULE_PARM_DESC(book_file, "Opening book loaded through the firmware loader, an empty name disables it");
+
+// function prototypes
+static int chess_open(struct inode *inode, struct file *filp);
+static int chess_release(struct inode *inode, struct file *filp);
+static ssize_t chess_read(struct file *filp, char __user *buf, size_t len, loff_t *off);
+static ssize_t chess_write(struct file *filp, const char __user *buf, size_t len, loff_t *off);
+static u16 generate_cpu_move(struct chess_session *session, struct position *pos);
+static __poll_t chess_poll(struct file *filp, struct poll_table_struct *wait);
+static long chess_ioctl(struct file *filp, unsigned int cmd, unsigned long arg);
+static int chess_mmap(struct file *filp, struct vm_area_struct *vma);
+static void publish_snapshot(struct chess_session *session);
+static void handle_cpu_turn(struct chess_session *session);
+static void handle_resign_game(struct chess_session *session);
+
+// file operations structure
+static const struct file_operations chess_fops = {
+    .owner = THIS_MODULE,
+    .open = chess_open,
+    .release = chess_release,
+    .read = chess_read,
+    .write = chess_write,
+    .poll = chess_poll,
+    .unlocked_ioctl = chess_ioctl,
+    .compat_ioctl = compat_ptr_ioctl,
+    .mmap = chess_mmap,
+};
+
+// misc device structure
+static struct miscdevice chess_misc_device = {
+    .minor = MISC_DYNAMIC_MINOR,
+    .name = DEV_NAME,
+    .fops = &chess_fops,
+    .groups = stats_groups,
+};
+
+// function to record the result of a command along with its text response
+static void set_result(struct chess_session *session, int result) {
+    stats_inc(results[result]);
+    session->result = result;
+    strcpy(session->output_message, result_messages[result]);
+}
+
+// function to update the game state based on the player's move
+static void update_game_state(struct chess_session *session, u16 move) {
+    history_push(&session->history, session->pos.key, move);
+    commit_move(&session->pos, move);
+    session->last_move = move;
+    session->move_count++;
+}
+
+// function to start a game from the position in session->pos with the player on the given color
+static void start_game(struct chess_session *session, int player_color) {
+    session->player_color = player_color;
+    session->cpu_color = !player_color;
+    session->game_started = true;
+    session->player_turn = session->pos.side == player_color;
+    session->last_move = 0;
+    session->move_count = 0;
+    memset(&session->stats, 0, sizeof(session->stats));
+    history_clear(&session->history);
+    set_result(session, CHESS_RESULT_OK);
+}
+
+// function to tell if the game is over in session->pos, from a single count of the legal moves of the side to move
+// returns the result that ends it, CHESS_RESULT_CHECK if the side to move is in check, or CHESS_RESULT_OK
+static int game_result(struct chess_session *session) {
+    struct position *pos = &session->pos;
+    bool in_check = square_attacked_by(pos, !pos->side, king_square(pos, pos->side));
+
+    generate_legal(pos, &session->moves[0]);
+    if (session->moves[0].count == 0) {
+        if (!in_check) {
+            return CHESS_RESULT_DRAW_STALEMATE;
+        }
+        return pos->side == BLACK ? CHESS_RESULT_WHITE_MATES : CHESS_RESULT_BLACK_MATES;
+    }
+    if (insufficient_material(pos)) {
+        return CHESS_RESULT_DRAW_MATERIAL;
+    }
+    if (count_repetitions(pos, &session->history, 2) == 2) {
+        return CHESS_RESULT_DRAW_REPETITION;
+    }
+    if (pos->halfmove_clock >= FIFTY_MOVE_PLIES) {
+        return CHESS_RESULT_DRAW_FIFTY_MOVES;
+    }
+    return in_check ? CHESS_RESULT_CHECK : CHESS_RESULT_OK;
+}
+
+// function to report the state of the game after a move, ending it on a mate or draw
+static void report_game_result(struct chess_session *session) {
+    int result = game_result(session);
+
+    set_result(session, result);
+    if (result != CHESS_RESULT_OK && result != CHESS_RESULT_CHECK) {
+        session->game_started = false;
+    }
+}
+
+// function to check that the player may move now, setting the result if not
+static bool player_may_move(struct chess_session *session) {
+    // check if there's an active game
+    if (!session->game_started) {
+        set_result(session, CHESS_RESULT_NOGAME);
+        return false;
+    }
+
+    if (!session->player_turn) {
+        set_result(session, CHESS_RESULT_OOT);
+        return false;
+    }
+    return true;
+}
+
+// function to play a legal player move and report the game state
+static void finish_player_move(struct chess_session *session, u16 packed_move) {
+    // update the game state with the player's move
+    update_game_state(session, packed_move);
+
+    // respond based on the game state the move leaves
+    report_game_result(session);
+
+    // set player's turn
+    session->player_turn = false;
+}
+
+// function to handle a packed player move from the ioctl interface
+static void handle_packed_move(struct chess_session *session, u16 move) {
+    u16 legal_move;
+
+    if (!player_may_move(session)) {
+        return;
+    }
+
+    legal_move = find_legal_move(&session->pos, move);
+    if (!legal_move) {
+        set_result(session, CHESS_RESULT_ILLMOVE);
+        return;
+    }
+    finish_player_move(session, legal_move);
+}
+
+// function to handle the player's move
+static void handle_player_move(struct chess_session *session, const char *move) {
+    u16 packed_move;
+
+    if (!player_may_move(session)) {
+        return;
+    }
+
+    if (move[0] != color_chars[session->player_color]) {
+        set_result(session, CHESS_RESULT_ILLMOVE);
+        return;
+    }
+
+    // validate the move
+    stats_inc(validations);
+    if (!validate_move(&session->pos, move)) {
+        set_result(session, CHESS_RESULT_ILLMOVE);
+        return;
+    }
+    
+    // the generated move it stands for, none if it puts the player's own king in check or may not castle
+    packed_move = find_legal_move(&session->pos, parse_move(&session->pos, move));
+    if (!packed_move) {
+        set_result(session, CHESS_RESULT_ILLMOVE);
+        return;
+    }
+    finish_player_move(session, packed_move);
+}
+
+// function to search a CPU move in the given copy of the game, returns 0 if there are no legal moves
+static u16 generate_cpu_move(struct chess_session *session, struct position *pos) {
+    struct move_list *root = &session->search_root;
+    u16 move;
+
+    generate_legal(pos, root);
+
+    // if there are no legal moves, return
+    if (root->count == 0) {
+        return 0;
+    }
+
+    // a book move is played without searching
+    move = book_probe(pos);
+    session->book_move = move != 0;
+    if (move) {
+        memset(&session->search_stats, 0, sizeof(session->search_stats));
+        stats_inc(book_moves);
+        return move;
+    }
+    move = search_best_move(session->workspace, pos, &session->history, root, session->search_depth,
+                            session->search_time_ms, &session->cancel_search, &session->search_stats);
+    stats_search(&session->search_stats);
+    return move;
+}
+
+// function to add the CPU move just played to the counters of the game
+static void count_cpu_move(struct chess_session *session) {
+    struct game_stats *stats = &session->stats;
+    const struct search_stats *search = &session->search_stats;
+
+    if (session->book_move) {
+        stats->book_moves++;
+    } 
+    else {
+        stats->searches++;
+        stats->nodes += search->nodes;
+        stats->tt_hits += search->tt_hits;
+        stats->cutoffs += search->cutoffs;
+        stats->nanoseconds += search->nanoseconds;
+    }
+    stats->last = *search;
+}
+
+// function to play the searched CPU move and report the game state, called with the session locked
+// no move means the CPU had no legal move, so the position it was given is reported as mate or stalemate
+static void finish_cpu_turn(struct chess_session *session, u16 move) {
+    if (move) {
+        update_game_state(session, move);
+        count_cpu_move(session);
+    }
+
+    // check game state after CPU move
+    report_game_result(session);
+
+    // set player's turn
+    session->player_turn = true;
+}
+
+// searches a queued CPU move without the session lock, then plays it unless the search was cancelled
+static void search_work_fn(struct work_struct *work) {
+    struct chess_session *session = container_of(work, struct chess_session, search_work);
+    u16 move = generate_cpu_move(session, &session->search_pos);
+
+    mutex_lock(&session->lock);
+    if (!session->cancel_search) {
+        finish_cpu_turn(session, move);
+    }
+    session->searching = false;
+    publish_snapshot(session);
+    mutex_unlock(&session->lock);
+    wake_up_interruptible(&session->wait);
+}
+
+// function to handle the CPU's turn
+static void handle_cpu_turn(struct chess_session *session) {
+    if (!session->game_started) {
+        set_result(session, CHESS_RESULT_NOGAME);
+        return;
+    }
+
+    if (session->player_turn) {
+        set_result(session, CHESS_RESULT_OOT);
+        return;
+    }
+
+    // a search cancelled earlier leaves the flag set, and it would stop this one on its first node
+    session->cancel_search = false;
+    if (!session->async) {
+        finish_cpu_turn(session, generate_cpu_move(session, &session->pos));
+        return;
+    }
+
+    // the response is written by the worker, reads wait for it until then
+    session->search_pos = session->pos;
+    session->searching = true;
+    set_result(session, CHESS_RESULT_PENDING);
+    queue_work(search_wq, &session->search_work);
+}
+
+// function to handle the player resigning the game
+static void handle_resign_game(struct chess_session *session) {
+    // check if there's an active game
+    if (!session->game_started) {
+        set_result(session, CHESS_RESULT_NOGAME);
+        return;
+    }
+
+    // check if it's the player's turn
+    if (!session->player_turn) {
+        set_result(session, CHESS_RESULT_OOT);
+        return;
+    }
+
+    // the player resigns, so CPU wins
+    if (session->player_color == WHITE) {
+        set_result(session, CHESS_RESULT_BLACK_WINS);
+    } 
+    else {
+        set_result(session, CHESS_RESULT_WHITE_WINS);
+    }
+    session->game_started = false;
+    session->player_turn = false;
+}
+
+// function to set the difficulty as "D<plies>" for the search depth or "T<milliseconds>" for the time budget
+static void handle_difficulty(struct chess_session *session, const char *setting) {
+    unsigned int value;
+
+    if ((setting[0] != 'D' && setting[0] != 'T') || kstrtouint(setting + 1, 10, &value)) {
+        set_result(session, CHESS_RESULT_INVFMT);
+        return;
+    }
+
+    if (setting[0] == 'D' && value >= 1 && value <= MAX_SEARCH_DEPTH) {
+        session->search_depth = value;
+    } 
+    else if (setting[0] == 'T' && value >= 1 && value <= MAX_SEARCH_TIME_MS) {
+        session->search_time_ms = value;
+    } 
+    else {
+        set_result(session, CHESS_RESULT_INVFMT);
+        return;
+    }
+    set_result(session, CHESS_RESULT_OK);
+}
+
+// function to run a timed perft on the current position
+static void run_perft(struct chess_session *session, int depth, struct chess_perft *result) {
+    u64 start = ktime_get_ns();
+
+    result->nodes = perft(&session->pos, depth, session->moves);
+    result->nanoseconds = ktime_get_ns() - start;
+    result->nodes_per_second = 0;
+    if (result->nanoseconds) {
+        result->nodes_per_second = div64_u64(result->nodes * NSEC_PER_SEC, result->nanoseconds);
+    }
+}
+
+// function to count the perft nodes to the given depth and report them with the time taken
+static void handle_perft(struct chess_session *session, const char *setting) {
+    struct chess_perft result;
+    unsigned int depth;
+
+    if (kstrtouint(setting, 10, &depth) || depth < 1 || depth > MAX_PERFT_DEPTH) {
+        set_result(session, CHESS_RESULT_INVFMT);
+        return;
+    }
+    if (!session->game_started) {
+        set_result(session, CHESS_RESULT_NOGAME);
+        return;
+    }
+    run_perft(session, depth, &result);
+    snprintf(session->output_message, sizeof(session->output_message), "NODES %llu\nNS %llu\nNPS %llu\n",
+             result.nodes, result.nanoseconds, result.nodes_per_second);
+}
+
+// function to write the moves of the game from the given index, CHESS_MOVE_LOG_MAX of them at most, one per line
+// the first line holds the index of the first move written and the number of moves in the game
+static void handle_move_log(struct chess_session *session, const char *setting) {
+    u16 moves[CHESS_MOVE_LOG_MAX];
+    unsigned int offset;
+    struct seq_buf out;
+    u32 i, first, count;
+
+    if (kstrtouint(setting, 10, &offset)) {
+        set_result(session, CHESS_RESULT_INVFMT);
+        return;
+    }
+    count = history_read(&session->history, offset, moves, CHESS_MOVE_LOG_MAX, &first);
+
+    // leave room for the terminator, which seq_buf does not write
+    seq_buf_init(&out, session->output_message, sizeof(session->output_message) - 1);
+    seq_buf_printf(&out, "LOG %u %u\n", first, session->history.count);
+    for (i = 0; i < count; i++) {
+        write_move(moves[i], &out);
+        seq_buf_putc(&out, '\n');
+    }
+    session->output_message[seq_buf_used(&out)] = '\0';
+}
+
+// function to report the transposition table size and counters, and the search speed and average depth
+static void handle_stats(struct chess_session *session) {
+    u64 nodes = atomic64_read(&search_nodes);
+    u64 milliseconds = div64_u64(atomic64_read(&search_time_ns), NSEC_PER_MSEC); // nodes * NSEC_PER_SEC would overflow
+    u64 nodes_per_second = milliseconds ? div64_u64(nodes * MSEC_PER_SEC, milliseconds) : 0;
+    u64 searches = atomic64_read(&search_count);
+    u32 depth = searches ? div64_u64(atomic64_read(&search_depths) * 100, searches) : 0; // hundredths of a ply
+
+    snprintf(session->output_message, sizeof(session->output_message),
+             "TT %luKB\nHIT %lld\nMISS %lld\nCOLLISION %lld\nTHREADS %u\nDEPTH %u.%02u\nNODES %llu\nNPS %llu\n"
+             "BOOK %lu\nBOOKHIT %lld\n",
+             tt_size_kb(), atomic64_read(&tt_hits), atomic64_read(&tt_misses), atomic64_read(&tt_collisions),
+             search_threads, depth / 100, depth % 100, nodes, nodes_per_second, book_size(),
+             atomic64_read(&book_hits));
+}
+
+// function to render the board as the response in the session's display mode
+static void handle_display(struct chess_session *session) {
+    struct seq_buf out;
+
+    // leave room for the terminator, which seq_buf does not write
+    seq_buf_init(&out, session->output_message, sizeof(session->output_message) - 1);
+    display_board(&session->pos, session->display_mode, &out);
+    session->output_message[seq_buf_used(&out)] = '\0';
+}
+
+// function to load a position from "W <fen>" or "B <fen>" and start a game there with the player on that color
+static void handle_load_fen(struct chess_session *session, const char *args) {
+    // parsed into the search copy, which is unused while no search is queued, so a bad FEN leaves the game alone
+    struct position *scratch = &session->search_pos;
+
+    if ((args[0] != 'W' && args[0] != 'B') || args[1] != ' ' || load_fen(scratch, args + 2)) {
+        set_result(session, CHESS_RESULT_INVFMT);
+        return;
+    }
+    // the side that has just moved cannot be in check
+    if (square_attacked_by(scratch, scratch->side, king_square(scratch, !scratch->side))) {
+        set_result(session, CHESS_RESULT_INVFMT);
+        return;
+    }
+    session->pos = *scratch;
+    start_game(session, args[0] == 'W' ? WHITE : BLACK);
+    // a position that is already mated, stalemated, or drawn ends the game as soon as it is loaded
+    report_game_result(session);
+}
+
+// function to write the current position as FEN
+static void handle_dump_fen(struct chess_session *session) {
+    struct seq_buf out;
+
+    seq_buf_init(&out, session->output_message, sizeof(session->output_message) - 1);
+    write_fen(&session->pos, &out);
+    session->output_message[seq_buf_used(&out)] = '\0';
+}
+
+// function to report the static evaluation of the position and its terms, in centipawns from white's point of view
+static void handle_eval(struct chess_session *session) {
+    struct eval_terms terms;
+
+    evaluate_terms(&session->pos, &terms);
+    snprintf(session->output_message, sizeof(session->output_message),
+             "SCORE %d\nMATERIAL %d\nPLACEMENT %d\nMOBILITY %d\nKING %d\n", terms.total, terms.material,
+             terms.placement, terms.mobility, terms.king_safety);
+}
+
+// function to choose the display mode, "C" for the colored board, "P" for plain text, or "F" for one FEN-like line
+static void handle_display_mode(struct chess_session *session, const char *mode) {
+    if (strcmp(mode, "C") == 0) {
+        session->display_mode = DISPLAY_COLOR;
+    } 
+    else if (strcmp(mode, "P") == 0) {
+        session->display_mode = DISPLAY_PLAIN;
+    } 
+    else if (strcmp(mode, "F") == 0) {
+        session->display_mode = DISPLAY_COMPACT;
+    } 
+    else {
+        set_result(session, CHESS_RESULT_INVFMT);
+        return;
+    }
+    set_result(session, CHESS_RESULT_OK);
+}
+
+// function to choose how the CPU move is searched, "A" queues it and returns at once, "S" searches inside the write
+static void handle_async_mode(struct chess_session *session, const char *mode) {
+    if (strcmp(mode, "A") == 0) {
+        session->async = true;
+    } 
+    else if (strcmp(mode, "S") == 0) {
+        session->async = false;
+    } 
+    else {
+        set_result(session, CHESS_RESULT_INVFMT);
+        return;
+    }
+    set_result(session, CHESS_RESULT_OK);
+}
+
+// the counters of a session's game and of the search of its last CPU move, shown in its debugfs file
+static int game_stats_show(struct seq_file *m, void *unused) {
+    struct chess_session *session = m->private;
+    struct game_stats *stats = &session->stats;
+
+    if (mutex_lock_interruptible(&session->lock)) {
+        return -ERESTARTSYS;
+    }
+    seq_printf(m, "moves %u\nbook_moves %u\nsearches %u\nnodes %llu\ntt_hits %llu\ncutoffs %llu\nsearch_ns %llu\n",
+               session->move_count, stats->book_moves, stats->searches, stats->nodes, stats->tt_hits, stats->cutoffs,
+               stats->nanoseconds);
+    seq_printf(m, "last_nodes %llu\nlast_tt_hits %llu\nlast_cutoffs %llu\nlast_depth %d\nlast_search_ns %llu\n",
+               stats->last.nodes, stats->last.tt_hits, stats->last.cutoffs, stats->last.depth,
+               stats->last.nanoseconds);
+    mutex_unlock(&session->lock);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(game_stats);
+
+// open the device, every open file gets its own game
+static int chess_open(struct inode *inode, struct file *filp) {
+    struct chess_session *session = kmem_cache_zalloc(session_cache, GFP_KERNEL);
+    char name[16];
+
+    if (!session) {
+        return -ENOMEM;
+    }
+    // the snapshot gets a page of its own since it is mapped into user space
+    session->snapshot = (struct chess_snapshot *)get_zeroed_page(GFP_KERNEL);
+    // the memory of the searches is allocated up front, so a CPU move cannot run out of it
+    session->workspace = search_workspace_alloc();
+    if (!session->snapshot || !session->workspace) {
+        search_workspace_free(session->workspace);
+        free_page((unsigned long)session->snapshot);
+        kmem_cache_free(session_cache, session);
+        return -ENOMEM;
+    }
+    mutex_init(&session->lock);
+    INIT_WORK(&session->search_work, search_work_fn);
+    init_waitqueue_head(&session->wait);
+    session->search_depth = 4;
+    session->search_time_ms = 200;
+    memset(session->pos.board, NO_PIECE, sizeof(session->pos.board));
+    publish_snapshot(session);
+    snprintf(name, sizeof(name), "%d", atomic_inc_return(&session_ids));
+    session->debugfs = debugfs_create_file(name, 0444, stats_games_dir, session, &game_stats_fops);
+    filp->private_data = session;
+    return 0;
+}
+
+// release the game when its file is closed
+static int chess_release(struct inode *inode, struct file *filp) {
+    struct chess_session *session = filp->private_data;
+
+    // waits for readers of the debugfs file to finish
+    debugfs_remove(session->debugfs);
+    // nothing else uses the file anymore, so stop a queued search and wait for its worker
+    WRITE_ONCE(session->cancel_search, true);
+    cancel_work_sync(&session->search_work);
+    mutex_destroy(&session->lock);
+    // mappings hold a reference to the file, so none of them is left by now
+    free_page((unsigned long)session->snapshot);
+    search_workspace_free(session->workspace);
+    kmem_cache_free(session_cache, session);
+    return 0;
+}
+
+// read from the device
+static ssize_t chess_read(struct file *filp, char __user *buf, size_t len, loff_t *off) {
+    struct chess_session *session = filp->private_data;
+    ssize_t ret = 0; 
+
+    if (mutex_lock_interruptible(&session->lock)) {
+        return -ERESTARTSYS;
+    }
+    // the response to a queued CPU move is only known once its search is done
+    while (session->searching) {
+        mutex_unlock(&session->lock);
+        if (filp->f_flags & O_NONBLOCK) {
+            return -EAGAIN;
+        }
+        if (wait_event_interruptible(session->wait, !READ_ONCE(session->searching)) ||
+            mutex_lock_interruptible(&session->lock)) {
+            return -ERESTARTSYS;
+        }
+    }
+    // copy the output message to user buffer
+    ret = simple_read_from_buffer(buf, len, off, session->output_message, strlen(session->output_message));
+    mutex_unlock(&session->lock);
+
+    return ret;
+}
+
+// the response is readable unless a queued CPU move is still being searched, commands can always be written
+static __poll_t chess_poll(struct file *filp, struct poll_table_struct *wait) {
+    struct chess_session *session = filp->private_data;
+    __poll_t mask = EPOLLOUT | EPOLLWRNORM;
+
+    poll_wait(filp, &session->wait, wait);
+    if (!READ_ONCE(session->searching)) {
+        mask |= EPOLLIN | EPOLLRDNORM;
+    }
+    return mask;
+}
+
+// cancels a queued CPU move and waits for its worker, which stops within a few nodes
+// called with the session locked, returns with it locked unless interrupted
+static int cancel_search(struct chess_session *session) {
+    WRITE_ONCE(session->cancel_search, true);
+    mutex_unlock(&session->lock);
+    flush_work(&session->search_work);
+    if (mutex_lock_interruptible(&session->lock)) {
+        return -ERESTARTSYS;
+    }
+    // the cancelled move was never played, so the player may resign in its place
+    if (session->game_started && session->cancel_search) {
+        session->player_turn = true;
+    }
+    return 0;
+}
+
+// function to describe the game as CHESS_FLAG_* bits
+static u32 game_flags(struct chess_session *session) {
+    u32 flags = 0;
+
+    if (session->game_started) {
+        flags |= CHESS_FLAG_STARTED;
+    }
+    if (session->player_turn) {
+        flags |= CHESS_FLAG_PLAYER_TURN;
+    }
+    if (session->player_color == BLACK) {
+        flags |= CHESS_FLAG_PLAYER_BLACK;
+    }
+    if (session->pos.side == BLACK) {
+        flags |= CHESS_FLAG_BLACK_TO_MOVE;
+    }
+    if (session->game_started && square_attacked_by(&session->pos, !session->pos.side, king_square(&session->pos, session->pos.side))) {
+        flags |= CHESS_FLAG_CHECK;
+    }
+    if (session->searching) {
+        flags |= CHESS_FLAG_SEARCHING;
+    }
+    if (session->async) {
+        flags |= CHESS_FLAG_ASYNC;
+    }
+    return flags;
+}
+
+// function to rewrite the mapped snapshot page, called with the session locked
+// the sequence is odd while the page is written so lock-free readers can retry a torn copy
+static void publish_snapshot(struct chess_session *session) {
+    struct chess_snapshot *snapshot = session->snapshot;
+    int sq;
+
+    WRITE_ONCE(snapshot->sequence, snapshot->sequence + 1);
+    smp_wmb();
+    snapshot->flags = game_flags(session);
+    snapshot->move_count = session->move_count;
+    snapshot->result = session->result;
+    snapshot->last_move = session->last_move;
+    snapshot->side_to_move = session->pos.side;
+    for (sq = 0; sq < NUM_SQUARES; sq++) {
+        snapshot->squares[sq] = session->pos.board[sq];
+    }
+    smp_wmb();
+    WRITE_ONCE(snapshot->sequence, snapshot->sequence + 1);
+}
+
+// runs one ioctl on its copied argument, called with the session locked
+static long execute_ioctl(struct chess_session *session, unsigned int cmd, union chess_ioctl_arg *arg) {
+    int sq;
+
+    switch (cmd) {
+    case CHESS_IOC_NEW_GAME:
+        if (arg->game.player_color != WHITE && arg->game.player_color != BLACK) {
+            return -EINVAL;
+        }
+        initialize_board(&session->pos);
+        start_game(session, arg->game.player_color);
+        return 0;
+    case CHESS_IOC_MOVE:
+        handle_packed_move(session, arg->move.move);
+        arg->move.result = session->result;
+        return 0;
+    case CHESS_IOC_CPU_MOVE:
+        // in async mode the move is queued, its result is read with CHESS_IOC_STATUS once the file polls readable
+        handle_cpu_turn(session);
+        arg->move.move = session->result == CHESS_RESULT_PENDING ? 0 : session->last_move;
+        arg->move.result = session->result;
+        return 0;
+    case CHESS_IOC_GET_BOARD:
+        for (sq = 0; sq < NUM_SQUARES; sq++) {
+            arg->board.squares[sq] = session->pos.board[sq];
+        }
+        arg->board.flags = game_flags(session);
+        return 0;
+    case CHESS_IOC_PERFT:
+        if (arg->perft.depth < 1 || arg->perft.depth > MAX_PERFT_DEPTH) {
+            return -EINVAL;
+        }
+        arg->perft.result = session->game_started ? CHESS_RESULT_OK : CHESS_RESULT_NOGAME;
+        if (session->game_started) {
+            run_perft(session, arg->perft.depth, &arg->perft);
+        }
+        return 0;
+    case CHESS_IOC_MOVE_LOG:
+        arg->log.count = history_read(&session->history, arg->log.offset, arg->log.moves, CHESS_MOVE_LOG_MAX,
+                                      &arg->log.first);
+        arg->log.total = session->history.count;
+        return 0;
+    case CHESS_IOC_RESIGN:
+        handle_resign_game(session);
+        fallthrough;
+    case CHESS_IOC_STATUS:
+        arg->status.flags = game_flags(session);
+        arg->status.result = session->result;
+        arg->status.last_move = session->last_move;
+        return 0;
+    }
+    return -ENOTTY;
+}
+
+// the kind an ioctl is counted as in the statistics, the number of the text command it mirrors
+static int ioctl_kind(unsigned int cmd) {
+    switch (cmd) {
+    case CHESS_IOC_NEW_GAME:
+        return 0;
+    case CHESS_IOC_GET_BOARD:
+        return 1;
+    case CHESS_IOC_MOVE:
+        return 2;
+    case CHESS_IOC_CPU_MOVE:
+        return 3;
+    case CHESS_IOC_RESIGN:
+        return 4;
+    case CHESS_IOC_PERFT:
+        return 11;
+    case CHESS_IOC_MOVE_LOG:
+        return 13;
+    case CHESS_IOC_STATUS:
+        return STAT_STATUS;
+    }
+    return STAT_UNKNOWN;
+}
+
+// binary interface, the same commands as the text protocol without formatting or parsing
+// tells if an ioctl is a resignation or a new game with a valid color, the only ones that cancel a queued CPU move
+static bool ioctl_cancels_search(unsigned int cmd, const union chess_ioctl_arg *arg) {
+    return cmd == CHESS_IOC_RESIGN ||
+           (cmd == CHESS_IOC_NEW_GAME && (arg->game.player_color == WHITE || arg->game.player_color == BLACK));
+}
+
+static long chess_ioctl(struct file *filp, unsigned int cmd, unsigned long arg) {
+    struct chess_session *session = filp->private_data;
+    void __user *argp = (void __user *)arg;
+    union chess_ioctl_arg data;
+    u64 start;
+    long ret;
+
+    if (_IOC_TYPE(cmd) != CHESS_IOC_MAGIC || _IOC_SIZE(cmd) > sizeof(data) || _IOC_SIZE(cmd) < sizeof(data.version)) {
+        return -ENOTTY;
+    }
+    if (copy_from_user(&data, argp, _IOC_SIZE(cmd))) {
+        return -EFAULT;
+    }
+    if (data.version != CHESS_IOCTL_VERSION) {
+        return -EINVAL;
+    }
+
+    if (mutex_lock_interruptible(&session->lock)) {
+        return -ERESTARTSYS;
+    }
+    // like the text commands, a valid new game or a resignation cancels a queued CPU move and other moves wait for it
+    // the lock is dropped while cancelling, so another command may queue a new move, which is cancelled in turn
+    while (session->searching && ioctl_cancels_search(cmd, &data)) {
+        if (cancel_search(session)) {
+            return -ERESTARTSYS;
+        }
+    }
+    if (session->searching && (cmd == CHESS_IOC_MOVE || cmd == CHESS_IOC_CPU_MOVE || cmd == CHESS_IOC_PERFT)) {
+        ret = -EBUSY;
+    } 
+    else {
+        start = ktime_get_ns();
+        ret = execute_ioctl(session, cmd, &data);
+        stats_count(ioctl_kind(cmd), ktime_get_ns() - start);
+        publish_snapshot(session);
+    }
+    mutex_unlock(&session->lock);
+
+    if (ret == 0 && (_IOC_DIR(cmd) & _IOC_READ) && copy_to_user(argp, &data, _IOC_SIZE(cmd))) {
+        return -EFAULT;
+    }
+    return ret;
+}
+
+// map the snapshot page read-only, so clients can watch the game without any system call
+static int chess_mmap(struct file *filp, struct vm_area_struct *vma) {
+    struct chess_session *session = filp->private_data;
+
+    if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start != PAGE_SIZE) {
+        return -EINVAL;
+    }
+    if (vma->vm_flags & VM_WRITE) {
+        return -EPERM;
+    }
+    // keep mprotect() from making the mapping writable later
+    vm_flags_mod(vma, VM_DONTEXPAND | VM_DONTDUMP, VM_MAYWRITE);
+    return remap_pfn_range(vma, vma->vm_start, virt_to_phys(session->snapshot) >> PAGE_SHIFT, PAGE_SIZE, vma->vm_page_prot);
+}
+
+// runs one command copied from user space, called with the session locked
+static void execute_command(struct chess_session *session, char *command, size_t len) {
+    // check if the last character is a newline
+    if (command[len - 1] != '\n') {
+        set_result(session, CHESS_RESULT_UNKCMD);
+        return;
+    }
+
+    // ensure the command string is null-terminated
+    command[len - 1] = '\0';
+
+    if (strncmp(command, "00 W", 4) == 0) { // start new game as white
+        if (len != 5) { 
+            // command length must be exactly 4 characters + newline
+            set_result(session, CHESS_RESULT_INVFMT);
+        } else {
+            initialize_board(&session->pos);
+            start_game(session, WHITE);
+        }
+    } 
+    else if (strncmp(command, "00 B", 4) == 0) { // start new game as black
+        if (len != 5) { 
+            // command length must be exactly 4 characters + newline
+            set_result(session, CHESS_RESULT_INVFMT);
+        } else {
+            initialize_board(&session->pos);
+            start_game(session, BLACK);
+        }
+    } 
+    else if (strncmp(command, "01", 2) == 0) { // gets the current state of the game
+        if (len != 3) { 
+            // command length must be exactly 2 characters + newline
+            set_result(session, CHESS_RESULT_INVFMT);
+        } else if (session->game_started) {
+            // when game has been started
+            handle_display(session);
+        } else {
+            // when no game has been started
+            set_result(session, CHESS_RESULT_NOGAME);
+        }
+    } 
+    else if (strncmp(command, "02 ", 3) == 0) { // player move
+        handle_player_move(session, command + 3); 
+    } 
+    else if (strncmp(command, "03", 2) == 0) { // CPU move
+        if (len != 3) { 
+            // command length must be exactly 2 characters + newline
+            set_result(session, CHESS_RESULT_INVFMT);
+        }
+        else {
+            handle_cpu_turn(session);
+        }
+    } 
+    else if (strncmp(command, "04", 2) == 0) { // ends game
+        if (len != 3) { 
+            // command length must be exactly 2 characters + newline
+            set_result(session, CHESS_RESULT_INVFMT);
+        }
+        else {
+            handle_resign_game(session);
+        }
+    } 
+    else if (strncmp(command, "05 ", 3) == 0) { // sets the difficulty
+        handle_difficulty(session, command + 3);
+    } 
+    else if (strncmp(command, "06", 2) == 0) { // reports engine statistics
+        if (len != 3) { 
+            // command length must be exactly 2 characters + newline
+            set_result(session, CHESS_RESULT_INVFMT);
+        }
+        else {
+            handle_stats(session);
+        }
+    } 
+    else if (strncmp(command, "07 ", 3) == 0) { // chooses whether CPU moves are searched asynchronously
+        handle_async_mode(session, command + 3);
+    } 
+    else if (strncmp(command, "08 ", 3) == 0) { // chooses how the board is displayed
+        handle_display_mode(session, command + 3);
+    } 
+    else if (strncmp(command, "09 ", 3) == 0) { // loads a position from FEN
+        handle_load_fen(session, command + 3);
+    } 
+    else if (strncmp(command, "10", 2) == 0) { // writes the position as FEN
+        if (len != 3) { 
+            // command length must be exactly 2 characters + newline
+            set_result(session, CHESS_RESULT_INVFMT);
+        } else if (session->game_started) {
+            handle_dump_fen(session);
+        } else {
+            set_result(session, CHESS_RESULT_NOGAME);
+        }
+    } 
+    else if (strncmp(command, "11 ", 3) == 0) { // counts the perft nodes of the position
+        handle_perft(session, command + 3);
+    } 
+    else if (strncmp(command, "12", 2) == 0) { // reports the evaluation of the position
+        if (len != 3) { 
+            // command length must be exactly 2 characters + newline
+            set_result(session, CHESS_RESULT_INVFMT);
+        } else if (session->game_started) {
+            handle_eval(session);
+        } else {
+            set_result(session, CHESS_RESULT_NOGAME);
+        }
+    } 
+    else if (strncmp(command, "13 ", 3) == 0) { // streams the moves of the game from an index
+        handle_move_log(session, command + 3);
+    } 
+    else { // When none of the commands matched
+        set_result(session, CHESS_RESULT_UNKCMD);
+    }
+}
+
+// the kind a text command is counted as in the statistics, commands 00 to 13 by their number
+static int command_kind(const char *command, size_t len) {
+    int number;
+
+    if (len < 3 || command[0] < '0' || command[0] > '9' || command[1] < '0' || command[1] > '9') {
+        return STAT_UNKNOWN;
+    }
+    number = (command[0] - '0') * 10 + command[1] - '0';
+    return number < STAT_TEXT_COMMANDS ? number : STAT_UNKNOWN;
+}
+
+// tells if a text command is a well-formed new game or resignation, the only commands that cancel a queued CPU move
+// a malformed one is answered with INVFMT, so it must not hand the turn to the player by cancelling the move
+static bool command_cancels_search(const char *command, size_t len) {
+    return (len == 5 && (memcmp(command, "00 W\n", 5) == 0 || memcmp(command, "00 B\n", 5) == 0)) ||
+           (len == 3 && memcmp(command, "04\n", 3) == 0);
+}
+
+static ssize_t chess_write(struct file *filp, const char __user *buf, size_t len, loff_t *off) {
+    struct chess_session *session = filp->private_data;
+    char command[MAX_COMMAND_LEN + 1]; // Fixed-size buffer to hold the command string, long enough for a FEN
+    // command cannot be larger than this many characters, and is copied before taking the lock since it may fault
+    bool copied = len > 0 && len <= MAX_COMMAND_LEN && copy_from_user(command, buf, len) == 0;
+    int kind = copied ? command_kind(command, len) : STAT_UNKNOWN;
+    u64 start;
+
+    if (mutex_lock_interruptible(&session->lock)) {
+        return -ERESTARTSYS;
+    }
+    // a new game or a resignation cancels a queued CPU move
+    if (session->searching && copied && command_cancels_search(command, len) && cancel_search(session)) {
+        return -ERESTARTSYS;
+    }
+    // any other command would replace the response the worker is about to write
+    if (session->searching) {
+        mutex_unlock(&session->lock);
+        return -EBUSY;
+    }
+    start = ktime_get_ns();
+    if (copied) {
+        execute_command(session, command, len);
+    } 
+    else {
+        set_result(session, CHESS_RESULT_UNKCMD);
+    }
+    stats_count(kind, ktime_get_ns() - start);
+    publish_snapshot(session);
+    // the response to every command is read from its start
+    *off = 0;
+    mutex_unlock(&session->lock);
+    return len;
+}
+
+// function to load the opening book through the firmware loader, without a book every CPU move is searched
+static void load_book(void) {
+    const struct firmware *fw;
+    int ret;
+
+    if (!book_file[0] || firmware_request_nowarn(&fw, book_file, chess_misc_device.this_device)) {
+        return;
+    }
+    ret = book_load(fw->data, fw->size);
+    release_firmware(fw);
+    if (ret) {
+        printk(KERN_WARNING "Could not load the opening book %s\n", book_file);
+    }
+}
+
+// module initialization function
+static int __init chess_init(void) {
+    int ret;
+
+    // the ioctl interface passes pieces and moves through unchanged
+    BUILD_BUG_ON(CHESS_EMPTY != NO_PIECE || CHESS_BLACK != BLACK || CHESS_KING != KING);
+    BUILD_BUG_ON(CHESS_MOVE_CAPTURE != MOVE_CAPTURE || CHESS_MOVE_PROMOTION != MOVE_PROMOTION);
+    BUILD_BUG_ON(CHESS_MOVE_KING_CASTLE != MOVE_KING_CASTLE || CHESS_MOVE_QUEEN_CASTLE != MOVE_QUEEN_CASTLE ||
+                 CHESS_MOVE_EN_PASSANT != MOVE_EN_PASSANT);
+    BUILD_BUG_ON(ARRAY_SIZE(result_messages) != STAT_RESULTS);
+
+    engine_init();
+    ret = stats_init();
+    if (ret) {
+        return ret;
+    }
+    if (tt_allocate(tt_size_mb)) {
+        printk(KERN_WARNING "Could not allocate the transposition table\n");
+    }
+    search_threads = search_set_threads(search_threads);
+
+    session_cache = kmem_cache_create("chess_session", sizeof(struct chess_session), 0, 0, NULL);
+    if (!session_cache) {
+        tt_free();
+        stats_exit();
+        return -ENOMEM;
+    }
+
+    // unbound, since a search runs for up to its whole time budget and should not hold up other work on its CPU
+    search_wq = alloc_workqueue("chess_search", WQ_UNBOUND, 0);
+    if (!search_wq) {
+        kmem_cache_destroy(session_cache);
+        tt_free();
+        stats_exit();
+        return -ENOMEM;
+    }
+
+    ret = misc_register(&chess_misc_device);
+    if (ret) {
+        printk(KERN_ALERT "Could not register misc device\n");
+        destroy_workqueue(search_wq);
+        kmem_cache_destroy(session_cache);
+        tt_free();
+        stats_exit();
+        return ret;
+    }
+
+    // the firmware loader needs the device, games started meanwhile search until the book is in
+    load_book();
+    return 0;
+}
+
+// module exit function
+static void __exit chess_exit(void) {
+    misc_deregister(&chess_misc_device);
+    destroy_workqueue(search_wq);
+    kmem_cache_destroy(session_cache);
+    tt_free();
+    book_free();
+    stats_exit();
+}
+
+// calls initialization and exit
+module_init(chess_init);
+module_exit(chess_exit);
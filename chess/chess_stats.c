@@ -0,0 +1,220 @@
+/*
+description: counters and latency histograms of the device, kept per CPU and exported read-only through debugfs and sysfs
+*/
+#include <linux/module.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/device.h>
+#include <linux/slab.h>
+
+#include "chess_stats.h"
+
+// names of the command kinds in debugfs
+static const char *const kind_names[STAT_KINDS] = {
+    "00", "01", "02", "03", "04", "05", "06", "07", "08", "09", "10", "11", "12", "13",
+    [STAT_STATUS] = "status",
+    [STAT_UNKNOWN] = "unknown",
+    [STAT_SEARCH] = "search",
+};
+
+// names of the results in debugfs
+static const char *const result_names[STAT_RESULTS] = {
+    [CHESS_RESULT_OK] = "OK",
+    [CHESS_RESULT_CHECK] = "CHECK",
+    [CHESS_RESULT_NOGAME] = "NOGAME",
+    [CHESS_RESULT_OOT] = "OOT",
+    [CHESS_RESULT_ILLMOVE] = "ILLMOVE",
+    [CHESS_RESULT_UNKCMD] = "UNKCMD",
+    [CHESS_RESULT_INVFMT] = "INVFMT",
+    [CHESS_RESULT_WHITE_MATES] = "WHITE_MATES",
+    [CHESS_RESULT_BLACK_MATES] = "BLACK_MATES",
+    [CHESS_RESULT_WHITE_WINS] = "WHITE_WINS",
+    [CHESS_RESULT_BLACK_WINS] = "BLACK_WINS",
+    [CHESS_RESULT_PENDING] = "PENDING",
+    [CHESS_RESULT_DRAW_REPETITION] = "DRAW_REPETITION",
+    [CHESS_RESULT_DRAW_FIFTY_MOVES] = "DRAW_FIFTY_MOVES",
+    [CHESS_RESULT_DRAW_STALEMATE] = "DRAW_STALEMATE",
+    [CHESS_RESULT_DRAW_MATERIAL] = "DRAW_MATERIAL",
+};
+
+// variables
+struct chess_stats __percpu *chess_stats;
+struct dentry *stats_games_dir;
+static struct dentry *stats_dir;
+
+// adds up one counter over every CPU, given its offset in struct chess_stats
+static u64 stats_sum(size_t offset) {
+    u64 sum = 0;
+    int cpu;
+
+    for_each_possible_cpu(cpu) {
+        sum += *(u64 *)((char *)per_cpu_ptr(chess_stats, cpu) + offset);
+    }
+    return sum;
+}
+
+// adds up every counter over every CPU, returns NULL if there is no memory for the totals
+static struct chess_stats *stats_read(void) {
+    struct chess_stats *total = kzalloc(sizeof(*total), GFP_KERNEL);
+    size_t i;
+
+    if (!total) {
+        return NULL;
+    }
+    for (i = 0; i < sizeof(*total) / sizeof(u64); i++) {
+        ((u64 *)total)[i] = stats_sum(i * sizeof(u64));
+    }
+    return total;
+}
+
+// adds the search of a CPU move to the counters of the current CPU
+void stats_search(const struct search_stats *search) {
+    int depth;
+
+    stats_count(STAT_SEARCH, search->nanoseconds);
+    stats_inc(searches);
+    this_cpu_add(chess_stats->nodes, search->nodes);
+    this_cpu_add(chess_stats->tt_hits, search->tt_hits);
+    this_cpu_add(chess_stats->cutoffs, search->cutoffs);
+    stats_inc(depths[search->depth]);
+    for (depth = 1; depth <= MAX_SEARCH_DEPTH; depth++) {
+        if (search->depth_ns[depth]) {
+            stats_inc(reached[depth]);
+            this_cpu_add(chess_stats->reached_ns[depth], search->depth_ns[depth]);
+        }
+    }
+}
+
+// each kind of command that was counted and its latency histogram, one line for each bucket that is not empty
+// a bucket is shown by the lowest latency it holds
+static int command_latency_show(struct seq_file *m, void *unused) {
+    struct chess_stats *total = stats_read();
+    int kind, bucket;
+
+    if (!total) {
+        return -ENOMEM;
+    }
+    for (kind = 0; kind < STAT_KINDS; kind++) {
+        if (!total->commands[kind]) {
+            continue;
+        }
+        seq_printf(m, "%s %llu\n", kind_names[kind], total->commands[kind]);
+        for (bucket = 0; bucket < STAT_LATENCY_BUCKETS; bucket++) {
+            if (total->latency[kind][bucket]) {
+                seq_printf(m, "  %llu ns %llu\n", bucket ? 1ULL << bucket : 0, total->latency[kind][bucket]);
+            }
+        }
+    }
+    kfree(total);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(command_latency);
+
+// how often each result was reported
+static int results_show(struct seq_file *m, void *unused) {
+    int result;
+
+    for (result = 0; result < STAT_RESULTS; result++) {
+        seq_printf(m, "%s %llu\n", result_names[result],
+                   stats_sum(offsetof(struct chess_stats, results) + result * sizeof(u64)));
+    }
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(results);
+
+// the CPU moves and the totals of their searches, then for each depth the searches that stopped there, the searches
+// that completed it, and the average time they took to complete it
+static int search_show(struct seq_file *m, void *unused) {
+    struct chess_stats *total = stats_read();
+    int depth;
+
+    if (!total) {
+        return -ENOMEM;
+    }
+    seq_printf(m, "book_moves %llu\nsearches %llu\nnodes %llu\ntt_hits %llu\ncutoffs %llu\n", total->book_moves,
+               total->searches, total->nodes, total->tt_hits, total->cutoffs);
+    for (depth = 0; depth <= MAX_SEARCH_DEPTH; depth++) {
+        seq_printf(m, "depth %d %llu reached %llu time_ns %llu\n", depth, total->depths[depth], total->reached[depth],
+                   total->reached[depth] ? div64_u64(total->reached_ns[depth], total->reached[depth]) : 0);
+    }
+    kfree(total);
+    return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(search);
+
+// sysfs attribute showing the total of one counter
+#define STATS_ATTR(name, field) \
+    static ssize_t name##_show(struct device *dev, struct device_attribute *attr, char *buf) { \
+        return sysfs_emit(buf, "%llu\n", stats_sum(offsetof(struct chess_stats, field))); \
+    } \
+    static DEVICE_ATTR_RO(name)
+
+STATS_ATTR(unknown_commands, results[CHESS_RESULT_UNKCMD]);
+STATS_ATTR(invalid_formats, results[CHESS_RESULT_INVFMT]);
+STATS_ATTR(illegal_moves, results[CHESS_RESULT_ILLMOVE]);
+STATS_ATTR(validations, validations);
+STATS_ATTR(book_moves, book_moves);
+STATS_ATTR(searches, searches);
+STATS_ATTR(search_nodes, nodes);
+STATS_ATTR(search_tt_hits, tt_hits);
+STATS_ATTR(search_cutoffs, cutoffs);
+
+// commands of every kind, not counting the searches
+static ssize_t commands_show(struct device *dev, struct device_attribute *attr, char *buf) {
+    u64 sum = 0;
+    int kind;
+
+    for (kind = 0; kind < STAT_KINDS; kind++) {
+        if (kind != STAT_SEARCH) {
+            sum += stats_sum(offsetof(struct chess_stats, commands) + kind * sizeof(u64));
+        }
+    }
+    return sysfs_emit(buf, "%llu\n", sum);
+}
+static DEVICE_ATTR_RO(commands);
+
+static struct attribute *stats_attrs[] = {
+    &dev_attr_commands.attr,
+    &dev_attr_unknown_commands.attr,
+    &dev_attr_invalid_formats.attr,
+    &dev_attr_illegal_moves.attr,
+    &dev_attr_validations.attr,
+    &dev_attr_book_moves.attr,
+    &dev_attr_searches.attr,
+    &dev_attr_search_nodes.attr,
+    &dev_attr_search_tt_hits.attr,
+    &dev_attr_search_cutoffs.attr,
+    NULL,
+};
+
+// the attributes appear in a stats directory of the device, created and removed with it
+static const struct attribute_group stats_group = {
+    .name = "stats",
+    .attrs = stats_attrs,
+};
+
+const struct attribute_group *stats_groups[] = {
+    &stats_group,
+    NULL,
+};
+
+// allocates the counters and creates the debugfs files, before the device is registered
+// the files are left out if debugfs is not available, which is not an error
+int stats_init(void) {
+    chess_stats = alloc_percpu(struct chess_stats);
+    if (!chess_stats) {
+        return -ENOMEM;
+    }
+    stats_dir = debugfs_create_dir("chess", NULL);
+    debugfs_create_file("commands", 0444, stats_dir, NULL, &command_latency_fops);
+    debugfs_create_file("results", 0444, stats_dir, NULL, &results_fops);
+    debugfs_create_file("search", 0444, stats_dir, NULL, &search_fops);
+    stats_games_dir = debugfs_create_dir("games", stats_dir);
+    return 0;
+}
+
+// removes the debugfs files and frees the counters, after the device is deregistered
+void stats_exit(void) {
+    debugfs_remove_recursive(stats_dir);
+    free_percpu(chess_stats);
+}
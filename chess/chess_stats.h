@@ -0,0 +1,72 @@
+/*
+description: counters and latency histograms of the device, kept per CPU and exported read-only through debugfs and sysfs
+*/
+#ifndef CHESS_STATS_H
+#define CHESS_STATS_H
+
+#include <linux/percpu.h>
+#include <linux/log2.h>
+#include <linux/sysfs.h>
+
+#include "engine.h"
+#include "chess_ioctl.h"
+
+// kinds of commands counted, text commands 00 to 13 by their number and each ioctl as the text command it mirrors
+#define STAT_TEXT_COMMANDS 14
+#define STAT_STATUS 14  // CHESS_IOC_STATUS, which no text command mirrors
+#define STAT_UNKNOWN 15 // writes and ioctls that name no command
+#define STAT_SEARCH 16  // the search of a CPU move, timed apart from its 03 since an asynchronous one outlives it
+#define STAT_KINDS 17
+
+// bucket i of a latency histogram counts the latencies from 2^i to 2^(i+1) - 1 nanoseconds, the last any longer one
+#define STAT_LATENCY_BUCKETS 32
+
+#define STAT_RESULTS (CHESS_RESULT_DRAW_MATERIAL + 1)
+
+// counters of one CPU, only ever incremented with this_cpu operations and added up over every CPU when read
+// a total read while other CPUs count may miss their last few increments
+struct chess_stats {
+    u64 commands[STAT_KINDS];
+    u64 latency[STAT_KINDS][STAT_LATENCY_BUCKETS];
+    u64 results[STAT_RESULTS]; // results reported by commands and CPU moves
+    u64 validations;           // player moves checked by validate_move()
+    u64 book_moves;            // CPU moves taken from the opening book
+    u64 searches;              // CPU moves searched, the counters below add up their search_stats
+    u64 nodes;
+    u64 tt_hits;
+    u64 cutoffs;
+    u64 depths[MAX_SEARCH_DEPTH + 1]; // searches by the deepest iteration they completed
+    u64 reached[MAX_SEARCH_DEPTH + 1];  // searches that completed each depth
+    u64 reached_ns[MAX_SEARCH_DEPTH + 1]; // time those searches took to complete it, added up
+};
+
+// counters of the game of one session, changed and read with the session locked
+struct game_stats {
+    u32 book_moves;
+    u32 searches;
+    u64 nodes;       // totals of the searches of the game
+    u64 tt_hits;
+    u64 cutoffs;
+    u64 nanoseconds;
+    struct search_stats last; // search of the last CPU move, zero if it came from the book
+};
+
+// variables
+extern struct chess_stats __percpu *chess_stats;
+extern struct dentry *stats_games_dir;               // debugfs directory holding a file for each open session
+extern const struct attribute_group *stats_groups[]; // sysfs attributes of the device
+
+// counts an event on the current CPU
+#define stats_inc(field) this_cpu_inc(chess_stats->field)
+
+// counts a command of the given kind and the time it took
+static inline void stats_count(int kind, u64 nanoseconds) {
+    this_cpu_inc(chess_stats->commands[kind]);
+    this_cpu_inc(chess_stats->latency[kind][min_t(int, ilog2(nanoseconds | 1), STAT_LATENCY_BUCKETS - 1)]);
+}
+
+void stats_search(const struct search_stats *search);
+int stats_init(void);
+void stats_exit(void);
+
+#endif
@@ -0,0 +1,315 @@
+/*
+description: the chess engine core shared by the kernel module and the userspace library
+*/
+#ifndef CHESS_ENGINE_H
+#define CHESS_ENGINE_H
+
+#include "chess_compat.h"
+
+// define constants for board dimension
+#define BOARD_SIZE 8
+#define NUM_SQUARES (BOARD_SIZE * BOARD_SIZE)
+
+// define colors
+#define WHITE 0
+#define BLACK 1
+
+// define piece types, a piece is indexed as color * PIECE_TYPES + type
+#define PAWN 0
+#define KNIGHT 1
+#define BISHOP 2
+#define ROOK 3
+#define QUEEN 4
+#define KING 5
+#define PIECE_TYPES 6
+#define NUM_PIECES (2 * PIECE_TYPES)
+#define NO_PIECE NUM_PIECES
+
+// helpers for packing and unpacking pieces and squares
+#define MAKE_PIECE(color, type) ((color) * PIECE_TYPES + (type))
+#define PIECE_COLOR(piece) ((piece) / PIECE_TYPES)
+#define PIECE_TYPE(piece) ((piece) % PIECE_TYPES)
+#define SQUARE(row, col) ((row) * BOARD_SIZE + (col))
+#define SQ_ROW(sq) ((sq) / BOARD_SIZE)
+#define SQ_COL(sq) ((sq) % BOARD_SIZE)
+#define NO_SQUARE NUM_SQUARES
+
+// castling rights
+#define CASTLE_WHITE_KING 0x1
+#define CASTLE_WHITE_QUEEN 0x2
+#define CASTLE_BLACK_KING 0x4
+#define CASTLE_BLACK_QUEEN 0x8
+#define CASTLE_ALL 0xf
+
+// position of a new game
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+// bitboard masks for files and ranks
+#define FILE_A 0x0101010101010101ULL
+#define FILE_B (FILE_A << 1)
+#define FILE_G (FILE_A << 6)
+#define FILE_H (FILE_A << 7)
+#define RANK_1 0xFFULL
+#define RANK_3 (RANK_1 << 16)
+#define RANK_6 (RANK_1 << 40)
+#define RANK_8 (RANK_1 << 56)
+#define LIGHT_SQUARES 0x55AA55AA55AA55AAULL // a1 is dark
+
+// packed 16 bit moves: bits 0-5 hold the source square, bits 6-11 the destination, bits 12-15 the flags
+#define MOVE_QUIET 0x0
+#define MOVE_DOUBLE_PUSH 0x1
+#define MOVE_KING_CASTLE 0x2  // the king moves two squares and the rook jumps over it
+#define MOVE_QUEEN_CASTLE 0x3
+#define MOVE_CAPTURE 0x4
+#define MOVE_EN_PASSANT 0x5   // a capture whose pawn is beside the destination, not on it
+#define MOVE_PROMOTION 0x8 // the low two flag bits hold the promoted type counted from the knight
+#define MAKE_MOVE(from, to, flags) ((u16)((from) | ((to) << 6) | ((flags) << 12)))
+#define MOVE_FROM(move) ((move) & 0x3f)
+#define MOVE_TO(move) (((move) >> 6) & 0x3f)
+#define MOVE_FLAGS(move) ((move) >> 12)
+#define MOVE_PROMOTED(move) (KNIGHT + (MOVE_FLAGS(move) & 0x3))
+
+// upper bound on the number of moves in any position, 218 is the most legal moves known in one
+#define MAX_MOVES 256
+
+// number of moves that can be made on a position before they have to be unmade
+#define MAX_PLY 128
+
+// search limits and scores
+#define MAX_SEARCH_DEPTH 8
+#define MAX_SEARCH_TIME_MS 10000
+#define MAX_SEARCH_THREADS 64
+#define MATE_SCORE 30000
+#define FIFTY_MOVE_PLIES 100 // halfmove clock at which a game is drawn
+#define INFINITE_SCORE 32000
+
+// game phases the evaluation blends between
+#define PHASE_MG 0
+#define PHASE_EG 1
+
+// display modes of command 01: the colored board, the same board in plain text, and one FEN-like line
+#define DISPLAY_COLOR 0
+#define DISPLAY_PLAIN 1
+#define DISPLAY_COMPACT 2
+
+// characters used for pieces in the text protocol, "**" marks an empty square
+#define EMPTY "**"
+
+// state that make_move() saves so unmake_move() can restore the position
+struct undo {
+    u64 key;     // hash key before the move
+    u16 move;    // move that was made, promotions are recorded in its flags
+    u8 captured; // piece taken by the move or NO_PIECE
+    u8 castling; // castling rights, en passant square, and halfmove clock before the move
+    u8 ep_square;
+    u16 halfmove_clock;
+};
+
+// bitboard representation of a position, square 0 is a1 and square 63 is h8
+struct position {
+    u64 pieces[NUM_PIECES]; // one bitboard per piece
+    u64 occupied[2];        // every square held by each color
+    u64 all;                // every occupied square
+    u64 key;                // zobrist hash of the pieces, side to move, castling rights, and en passant file
+    u8 board[NUM_SQUARES];  // piece on each square for constant time lookup
+    int king_sq[2];         // square of each king
+    int side;               // color to move
+    int castling;           // CASTLE_* rights that are left
+    int ep_square;          // square a pawn skipped with a double push on the last move, NO_SQUARE if none
+    int halfmove_clock;     // moves since the last capture or pawn move
+    int fullmove_number;    // starts at 1 and grows after each black move
+    int material;           // white's material minus black's, kept up to date as pieces are put and removed
+    int placement[2];       // white's piece-square score minus black's in each phase, kept up to date the same way
+    int phase;              // sum of the phase weights of the pieces on the board, 24 at the start
+    int ply;                // number of records on the undo stack
+    struct undo undo_stack[MAX_PLY];
+};
+
+// magic multiplier lookup for the attacks of a sliding piece on one square
+struct magic {
+    u64 mask;     // squares whose occupancy can block the piece, board edges excluded
+    u64 magic;    // multiplier that hashes every occupancy of the mask to a distinct slot
+    u64 *attacks; // slice of the shared attack table indexed by the hash
+    int shift;
+};
+
+// list of packed moves filled by the move generator, over 512 bytes, so the kernel code keeps lists in the session
+// or the search rather than on the stack
+struct move_list {
+    u16 moves[MAX_MOVES];
+    int count;
+};
+
+// what the legality of the moves of a position depends on, computed once by compute_legality()
+struct legality {
+    u64 checkers; // pieces giving check to the king of the side to move
+    u64 pinned;   // pieces of the side to move that alone stand between their king and an enemy slider
+    u64 evasions; // destinations that answer a single check, every square when not in check, none in double check
+    int king;     // square of the king of the side to move
+};
+
+// moves of one game and the keys of the positions they were played in, the last GAME_HISTORY_SIZE of them are kept
+#define GAME_HISTORY_SIZE 1024
+struct game_history {
+    u64 keys[GAME_HISTORY_SIZE];  // key of the position each move was played in
+    u16 moves[GAME_HISTORY_SIZE];
+    u32 count;                    // moves played since the game started, move i is in slot i % GAME_HISTORY_SIZE
+};
+
+// killer moves and history scores a search gathers to order the quiet moves of later positions
+#define HISTORY_MAX 16384
+struct move_order {
+    u16 killers[MAX_PLY][2]; // the last two quiet moves that caused a beta cutoff at each ply
+    s16 history[NUM_PIECES][NUM_SQUARES]; // how often and how deep moving a piece to a square caused a cutoff
+};
+
+// hands out the moves of one position best first: the hash move, winning and even captures, killers,
+// quiet moves, then the captures that lose material
+#define MAX_BAD_CAPTURES 32
+struct move_picker {
+    const struct position *pos;
+    const struct move_order *order;
+    struct move_list list;    // moves of the current stage
+    s16 scores[MAX_MOVES];    // ordering score of each move in the list
+    int index;                // moves of the list handed out so far
+    int stage;
+    u16 hash_move;            // 0 if there is none or it cannot be played here
+    u16 killers[2];           // killers handed out, skipped among the quiet moves
+    u16 bad_captures[MAX_BAD_CAPTURES]; // captures the exchange evaluation expects to lose, tried last
+    int bad_count;
+};
+
+// scores the evaluation reports, in centipawns from white's point of view
+struct eval_terms {
+    int material;
+    int placement;
+    int mobility;
+    int king_safety;
+    int total;
+};
+
+// counters of the search of one CPU move, summed over its threads
+struct search_stats {
+    u64 nodes;
+    u64 tt_hits;
+    u64 cutoffs;     // moves that failed high, in the search and the quiescence search
+    u64 nanoseconds;
+    int depth;       // deepest completed iteration, which chose the move
+    u64 depth_ns[MAX_SEARCH_DEPTH + 1]; // time until any thread first completed each depth, zero if none did
+};
+
+// memory of the searches of one game, only search.c sees inside
+struct search_workspace;
+
+// tables filled once by engine_init()
+extern u64 between_mask[NUM_SQUARES][NUM_SQUARES]; // squares strictly between two aligned squares
+extern u64 knight_attacks[NUM_SQUARES];
+extern u64 king_attacks[NUM_SQUARES];
+extern u64 pawn_attacks[2][NUM_SQUARES]; // squares attacked by a pawn of each color
+extern struct magic rook_magics[NUM_SQUARES];
+extern struct magic bishop_magics[NUM_SQUARES];
+extern const char color_chars[];
+extern const char type_chars[];
+extern const char fen_chars[];
+extern const int piece_values[PIECE_TYPES];
+extern const int phase_weights[PIECE_TYPES];
+extern int piece_square[2][NUM_PIECES][NUM_SQUARES]; // piece-square score of each piece in each phase, negative for black
+
+// transposition table statistics of every finished search
+extern atomic64_t tt_hits;
+extern atomic64_t tt_misses;
+extern atomic64_t tt_collisions;
+extern atomic64_t search_nodes;      // positions visited by every thread of every finished search
+extern atomic64_t search_time_ns;    // time spent searching
+extern atomic64_t search_count;      // finished searches
+extern atomic64_t search_depths;     // deepest completed iterations of every finished search, added up
+extern atomic64_t book_hits;         // CPU moves taken from the opening book
+
+// squares a bishop on sq attacks given the occupied squares
+static inline u64 bishop_attacks(int sq, u64 occupied) {
+    const struct magic *m = &bishop_magics[sq];
+    return m->attacks[((occupied & m->mask) * m->magic) >> m->shift];
+}
+
+// squares a rook on sq attacks given the occupied squares
+static inline u64 rook_attacks(int sq, u64 occupied) {
+    const struct magic *m = &rook_magics[sq];
+    return m->attacks[((occupied & m->mask) * m->magic) >> m->shift];
+}
+
+// square of the king of the given color
+static inline int king_square(const struct position *pos, int color) {
+    return pos->king_sq[color];
+}
+
+// board.c
+void __init engine_init(void);
+int parse_piece(const char *code);
+int load_fen(struct position *pos, const char *fen);
+void initialize_board(struct position *pos);
+void display_board(const struct position *pos, int mode, struct seq_buf *out);
+void write_fen(const struct position *pos, struct seq_buf *out);
+void write_move(u16 move, struct seq_buf *out);
+bool square_attacked_by(const struct position *pos, int color, int sq);
+u64 attackers_to(const struct position *pos, int sq, u64 occupied);
+void make_move(struct position *pos, u16 move);
+void unmake_move(struct position *pos);
+void commit_move(struct position *pos, u16 move);
+bool insufficient_material(const struct position *pos);
+
+// validate.c
+bool validate_move(const struct position *pos, const char *move);
+u16 parse_move(const struct position *pos, const char *move);
+
+// movegen.c
+void generate_moves(const struct position *pos, struct move_list *list);
+void generate_captures(const struct position *pos, struct move_list *list);
+void generate_quiets(const struct position *pos, struct move_list *list);
+void generate_tactical(const struct position *pos, struct move_list *list);
+bool move_is_pseudo_legal(const struct position *pos, u16 move);
+void compute_legality(const struct position *pos, struct legality *legality);
+bool move_is_legal(const struct position *pos, const struct legality *legality, u16 move);
+void filter_legal(const struct position *pos, struct move_list *list);
+void generate_legal(const struct position *pos, struct move_list *list);
+u64 perft(struct position *pos, int depth, struct move_list *lists);
+u16 find_legal_move(const struct position *pos, u16 move);
+
+// eval.c
+void __init initialize_eval(void);
+void evaluate_terms(const struct position *pos, struct eval_terms *terms);
+int evaluate(const struct position *pos);
+int see(const struct position *pos, u16 move);
+
+// order.c
+void picker_init(struct move_picker *picker, const struct position *pos, const struct move_order *order,
+                 u16 hash_move);
+void picker_init_quiescence(struct move_picker *picker, const struct position *pos);
+u16 picker_next(struct move_picker *picker);
+void order_update(struct move_order *order, const struct position *pos, u16 move, int depth);
+
+// search.c
+struct search_workspace *search_workspace_alloc(void);
+void search_workspace_free(struct search_workspace *workspace);
+u16 search_best_move(struct search_workspace *workspace, struct position *pos, const struct game_history *history,
+                     struct move_list *root, int max_depth, int time_ms, const bool *cancel,
+                     struct search_stats *stats);
+unsigned int search_set_threads(unsigned int threads);
+
+// history.c
+void history_clear(struct game_history *history);
+void history_push(struct game_history *history, u64 key, u16 move);
+u32 history_first(const struct game_history *history);
+u32 history_read(const struct game_history *history, u32 offset, u16 *moves, u32 max, u32 *first);
+int count_repetitions(const struct position *pos, const struct game_history *history, int limit);
+
+// book.c
+u64 polyglot_key(const struct position *pos);
+int book_load(const u8 *data, size_t size);
+void book_free(void);
+unsigned long book_size(void);
+u16 book_probe(struct position *pos);
+int tt_allocate(unsigned int size_mb);
+void tt_free(void);
+unsigned long tt_size_kb(void);
+
+#endif
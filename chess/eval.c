@@ -0,0 +1,320 @@
+/*
+description: static evaluation of a position: material, piece-square tables, mobility, and king safety
+*/
+#include "engine.h"
+
+// phase of a full set of pieces, the middlegame weight of a score falls from it to 0 as pieces come off
+#define PHASE_MAX 24
+
+// bonus of each own pawn right in front of a castled king, and half of it for one a square further
+#define SHIELD_BONUS 12
+
+// piece-square tables for white, laid out like a board seen from white's side with rank 8 first
+// black reads the same tables mirrored top to bottom
+static const int placement_tables[2][PIECE_TYPES][NUM_SQUARES] __initconst = {
+    [PHASE_MG] = {
+        [PAWN] = {
+              0,   0,   0,   0,   0,   0,   0,   0,
+             50,  50,  50,  50,  50,  50,  50,  50,
+             10,  10,  20,  30,  30,  20,  10,  10,
+              5,   5,  10,  25,  25,  10,   5,   5,
+              0,   0,   0,  20,  20,   0,   0,   0,
+              5,  -5, -10,   0,   0, -10,  -5,   5,
+              5,  10,  10, -20, -20,  10,  10,   5,
+              0,   0,   0,   0,   0,   0,   0,   0,
+        },
+        [KNIGHT] = {
+            -50, -40, -30, -30, -30, -30, -40, -50,
+            -40, -20,   0,   0,   0,   0, -20, -40,
+            -30,   0,  10,  15,  15,  10,   0, -30,
+            -30,   5,  15,  20,  20,  15,   5, -30,
+            -30,   0,  15,  20,  20,  15,   0, -30,
+            -30,   5,  10,  15,  15,  10,   5, -30,
+            -40, -20,   0,   5,   5,   0, -20, -40,
+            -50, -40, -30, -30, -30, -30, -40, -50,
+        },
+        [BISHOP] = {
+            -20, -10, -10, -10, -10, -10, -10, -20,
+            -10,   0,   0,   0,   0,   0,   0, -10,
+            -10,   0,   5,  10,  10,   5,   0, -10,
+            -10,   5,   5,  10,  10,   5,   5, -10,
+            -10,   0,  10,  10,  10,  10,   0, -10,
+            -10,  10,  10,  10,  10,  10,  10, -10,
+            -10,   5,   0,   0,   0,   0,   5, -10,
+            -20, -10, -10, -10, -10, -10, -10, -20,
+        },
+        [ROOK] = {
+              0,   0,   0,   0,   0,   0,   0,   0,
+              5,  10,  10,  10,  10,  10,  10,   5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+             -5,   0,   0,   0,   0,   0,   0,  -5,
+              0,   0,   0,   5,   5,   0,   0,   0,
+        },
+        [QUEEN] = {
+            -20, -10, -10,  -5,  -5, -10, -10, -20,
+            -10,   0,   0,   0,   0,   0,   0, -10,
+            -10,   0,   5,   5,   5,   5,   0, -10,
+             -5,   0,   5,   5,   5,   5,   0,  -5,
+              0,   0,   5,   5,   5,   5,   0,  -5,
+            -10,   5,   5,   5,   5,   5,   0, -10,
+            -10,   0,   5,   0,   0,   0,   0, -10,
+            -20, -10, -10,  -5,  -5, -10, -10, -20,
+        },
+        [KING] = {
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -30, -40, -40, -50, -50, -40, -40, -30,
+            -20, -30, -30, -40, -40, -30, -30, -20,
+            -10, -20, -20, -20, -20, -20, -20, -10,
+             20,  20,   0,   0,   0,   0,  20,  20,
+             20,  30,  10,   0,   0,  10,  30,  20,
+        },
+    },
+    // in the endgame pawns are worth more the closer they are to promoting and the king belongs in the center
+    [PHASE_EG] = {
+        [PAWN] = {
+              0,   0,   0,   0,   0,   0,   0,   0,
+             80,  80,  80,  80,  80,  80,  80,  80,
+             50,  50,  50,  50,  50,  50,  50,  50,
+             30,  30,  30,  30,  30,  30,  30,  30,
+             20,  20,  20,  20,  20,  20,  20,  20,
+             10,  10,  10,  10,  10,  10,  10,  10,
+             10,  10,  10,  10,  10,  10,  10,  10,
+              0,   0,   0,   0,   0,   0,   0,   0,
+        },
+        [KNIGHT] = {
+            -50, -40, -30, -30, -30, -30, -40, -50,
+            -40, -20,   0,   0,   0,   0, -20, -40,
+            -30,   0,  10,  15,  15,  10,   0, -30,
+            -30,   5,  15,  20,  20,  15,   5, -30,
+            -30,   0,  15,  20,  20,  15,   0, -30,
+            -30,   5,  10,  15,  15,  10,   5, -30,
+            -40, -20,   0,   5,   5,   0, -20, -40,
+            -50, -40, -30, -30, -30, -30, -40, -50,
+        },
+        [BISHOP] = {
+            -20, -10, -10, -10, -10, -10, -10, -20,
+            -10,   0,   0,   0,   0,   0,   0, -10,
+            -10,   0,   5,  10,  10,   5,   0, -10,
+            -10,   5,   5,  10,  10,   5,   5, -10,
+            -10,   0,  10,  10,  10,  10,   0, -10,
+            -10,  10,  10,  10,  10,  10,  10, -10,
+            -10,   5,   0,   0,   0,   0,   5, -10,
+            -20, -10, -10, -10, -10, -10, -10, -20,
+        },
+        [ROOK] = {
+              0,   0,   0,   0,   0,   0,   0,   0,
+              5,  10,  10,  10,  10,  10,  10,   5,
+              0,   0,   0,   0,   0,   0,   0,   0,
+              0,   0,   0,   0,   0,   0,   0,   0,
+              0,   0,   0,   0,   0,   0,   0,   0,
+              0,   0,   0,   0,   0,   0,   0,   0,
+              0,   0,   0,   0,   0,   0,   0,   0,
+              0,   0,   0,   0,   0,   0,   0,   0,
+        },
+        [QUEEN] = {
+            -20, -10, -10,  -5,  -5, -10, -10, -20,
+            -10,   0,   0,   0,   0,   0,   0, -10,
+            -10,   0,   5,   5,   5,   5,   0, -10,
+             -5,   0,   5,   5,   5,   5,   0,  -5,
+             -5,   0,   5,   5,   5,   5,   0,  -5,
+            -10,   0,   5,   5,   5,   5,   0, -10,
+            -10,   0,   0,   0,   0,   0,   0, -10,
+            -20, -10, -10,  -5,  -5, -10, -10, -20,
+        },
+        [KING] = {
+            -50, -40, -30, -20, -20, -30, -40, -50,
+            -30, -20, -10,   0,   0, -10, -20, -30,
+            -30, -10,  20,  30,  30,  20, -10, -30,
+            -30, -10,  30,  40,  40,  30, -10, -30,
+            -30, -10,  30,  40,  40,  30, -10, -30,
+            -30, -10,  20,  30,  30,  20, -10, -30,
+            -30, -30,   0,   0,   0,   0, -30, -30,
+            -50, -30, -30, -30, -30, -30, -30, -50,
+        },
+    },
+};
+
+// variables
+const int piece_values[PIECE_TYPES] = { 100, 320, 330, 500, 900, 0 };
+const int phase_weights[PIECE_TYPES] = { 0, 1, 1, 2, 4, 0 };
+int piece_square[2][NUM_PIECES][NUM_SQUARES];
+
+// bonus of each square a piece attacks that is neither its own nor covered by an enemy pawn, in each phase
+static const int mobility_weights[2][PIECE_TYPES] = {
+    [PHASE_MG] = { 0, 4, 5, 2, 1, 0 },
+    [PHASE_EG] = { 0, 4, 5, 4, 2, 0 },
+};
+
+// weight of each attack of a piece on the squares around the enemy king
+static const int king_attack_weights[PIECE_TYPES] = { 0, 8, 8, 12, 20, 0 };
+
+// percent of the attack weight counted by the number of pieces joining the attack, a lone attacker is no threat
+static const int king_attack_scale[] = { 0, 0, 50, 75, 88, 94, 97, 99 };
+
+// fill the piece-square scores of both colors, white's from the tables and black's mirrored and negated
+void __init initialize_eval(void) {
+    int phase, type, sq;
+
+    for (phase = PHASE_MG; phase <= PHASE_EG; phase++) {
+        for (type = PAWN; type <= KING; type++) {
+            for (sq = 0; sq < NUM_SQUARES; sq++) {
+                int white = SQUARE(BOARD_SIZE - 1 - SQ_ROW(sq), SQ_COL(sq));
+                piece_square[phase][MAKE_PIECE(WHITE, type)][sq] = placement_tables[phase][type][white];
+                piece_square[phase][MAKE_PIECE(BLACK, type)][sq] = -placement_tables[phase][type][sq];
+            }
+        }
+    }
+}
+
+// blends a middlegame and an endgame score by the material left on the board
+static int taper(const struct position *pos, int mg, int eg) {
+    int phase = pos->phase < PHASE_MAX ? pos->phase : PHASE_MAX;
+    return (mg * phase + eg * (PHASE_MAX - phase)) / PHASE_MAX;
+}
+
+// squares attacked by every pawn of a color
+static u64 pawn_attack_span(const struct position *pos, int color) {
+    u64 pawns = pos->pieces[MAKE_PIECE(color, PAWN)];
+    if (color == WHITE) {
+        return ((pawns & ~FILE_A) << 7) | ((pawns & ~FILE_H) << 9);
+    }
+    return ((pawns & ~FILE_A) >> 9) | ((pawns & ~FILE_H) >> 7);
+}
+
+// own pawns in front of a king that is still on its first two ranks
+static int pawn_shield(const struct position *pos, int color) {
+    int king = king_square(pos, color);
+    int row = color == WHITE ? SQ_ROW(king) : BOARD_SIZE - 1 - SQ_ROW(king);
+    int forward = color == WHITE ? BOARD_SIZE : -BOARD_SIZE;
+    u64 pawns = pos->pieces[MAKE_PIECE(color, PAWN)];
+    u64 files;
+
+    if (row > 1) {
+        return 0;
+    }
+    files = FILE_A << SQ_COL(king);
+    files |= ((files & ~FILE_A) >> 1) | ((files & ~FILE_H) << 1);
+    return SHIELD_BONUS * hweight64(pawns & files & (RANK_1 << (SQ_ROW(king + forward) * BOARD_SIZE))) +
+           SHIELD_BONUS / 2 * hweight64(pawns & files & (RANK_1 << (SQ_ROW(king + 2 * forward) * BOARD_SIZE)));
+}
+
+// mobility in both phases and the middlegame danger to the enemy king of one color's pieces
+static void piece_activity(const struct position *pos, int color, int *mobility_mg, int *mobility_eg, int *danger) {
+    u64 area = ~pos->occupied[color] & ~pawn_attack_span(pos, !color);
+    u64 zone = king_attacks[king_square(pos, !color)] | BIT_ULL(king_square(pos, !color));
+    int type, attackers = 0, weight = 0;
+
+    *mobility_mg = 0;
+    *mobility_eg = 0;
+    for (type = KNIGHT; type <= QUEEN; type++) {
+        u64 pieces = pos->pieces[MAKE_PIECE(color, type)];
+        while (pieces) {
+            int sq = __ffs64(pieces);
+            u64 attacks;
+
+            pieces &= pieces - 1;
+            if (type == KNIGHT) {
+                attacks = knight_attacks[sq];
+            } else {
+                attacks = (type != ROOK ? bishop_attacks(sq, pos->all) : 0) |
+                          (type != BISHOP ? rook_attacks(sq, pos->all) : 0);
+            }
+            *mobility_mg += mobility_weights[PHASE_MG][type] * hweight64(attacks & area);
+            *mobility_eg += mobility_weights[PHASE_EG][type] * hweight64(attacks & area);
+            if (attacks & zone) {
+                attackers++;
+                weight += king_attack_weights[type] * hweight64(attacks & zone);
+            }
+        }
+    }
+    if (attackers >= (int)ARRAY_SIZE(king_attack_scale)) {
+        attackers = ARRAY_SIZE(king_attack_scale) - 1;
+    }
+    *danger = weight * king_attack_scale[attackers] / 100;
+}
+
+// material a capture wins or loses once both sides have traded on its square for as long as it pays them,
+// each recapturing with its least valuable attacker while sliders behind the traded pieces join in
+int see(const struct position *pos, u16 move) {
+    int from = MOVE_FROM(move), to = MOVE_TO(move);
+    int gain[32], depth = 0, side = pos->side, type, on_square = PIECE_TYPE(pos->board[from]);
+    u64 occupied = pos->all & ~BIT_ULL(from);
+    u64 attackers, mine;
+
+    gain[0] = pos->board[to] != NO_PIECE ? piece_values[PIECE_TYPE(pos->board[to])] : 0;
+    if (MOVE_FLAGS(move) == MOVE_EN_PASSANT) {
+        // the pawn taken in passing stands beside the destination and leaves the board too
+        gain[0] = piece_values[PAWN];
+        occupied &= ~BIT_ULL(pos->side == WHITE ? to - BOARD_SIZE : to + BOARD_SIZE);
+    }
+    attackers = attackers_to(pos, to, occupied) & occupied;
+    if (MOVE_FLAGS(move) & MOVE_PROMOTION) {
+        on_square = MOVE_PROMOTED(move);
+        gain[0] += piece_values[on_square] - piece_values[PAWN];
+    }
+
+    while (depth + 1 < (int)ARRAY_SIZE(gain)) {
+        side ^= 1;
+        mine = attackers & pos->occupied[side];
+        if (!mine) {
+            break;
+        }
+        for (type = PAWN; !(mine & pos->pieces[MAKE_PIECE(side, type)]); type++) {
+        }
+        if (type == KING && (attackers & pos->occupied[!side])) {
+            break; // the king may not take on a square that is still defended
+        }
+        // the side taking now wins the piece on the square, less what it stood to win before
+        depth++;
+        gain[depth] = piece_values[on_square] - gain[depth - 1];
+        if (-gain[depth - 1] < 0 && gain[depth] < 0) {
+            break; // neither side can do better than stopping here
+        }
+        on_square = type;
+        occupied &= ~BIT_ULL(__ffs64(mine & pos->pieces[MAKE_PIECE(side, type)]));
+        attackers = attackers_to(pos, to, occupied) & occupied;
+    }
+
+    // walk back through the trades, each side stops as soon as going on would cost it
+    while (depth > 0) {
+        depth--;
+        if (gain[depth + 1] > -gain[depth]) {
+            gain[depth] = -gain[depth + 1];
+        }
+    }
+    return gain[0];
+}
+
+// splits the evaluation into its terms, all from white's point of view and blended by the game phase
+void evaluate_terms(const struct position *pos, struct eval_terms *terms) {
+    int mobility_mg[2], mobility_eg[2], danger[2], color;
+    int king_mg = 0;
+
+    for (color = WHITE; color <= BLACK; color++) {
+        piece_activity(pos, color, &mobility_mg[color], &mobility_eg[color], &danger[color]);
+    }
+    // the danger a side's pieces pose counts against the other king, the shield for its own
+    for (color = WHITE; color <= BLACK; color++) {
+        int safety = pawn_shield(pos, color) - danger[!color];
+        king_mg += color == WHITE ? safety : -safety;
+    }
+
+    terms->material = pos->material;
+    terms->placement = taper(pos, pos->placement[PHASE_MG], pos->placement[PHASE_EG]);
+    terms->mobility = taper(pos, mobility_mg[WHITE] - mobility_mg[BLACK], mobility_eg[WHITE] - mobility_eg[BLACK]);
+    terms->king_safety = taper(pos, king_mg, 0);
+    terms->total = terms->material + terms->placement + terms->mobility + terms->king_safety;
+}
+
+// score of a position from the point of view of the side to move
+int evaluate(const struct position *pos) {
+    struct eval_terms terms;
+
+    evaluate_terms(pos, &terms);
+    return pos->side == WHITE ? terms.total : -terms.total;
+}
@@ -0,0 +1,60 @@
+/*
+description: game history: a ring buffer of the moves of a game and the keys of the positions they were played in,
+used for repetition detection and to replay or stream the game
+*/
+#include "engine.h"
+
+// forgets every move, for a new game
+void history_clear(struct game_history *history) {
+    history->count = 0;
+}
+
+// records a move about to be played in the position with the given key, overwriting the oldest move when full
+void history_push(struct game_history *history, u64 key, u16 move) {
+    u32 slot = history->count % GAME_HISTORY_SIZE;
+
+    history->keys[slot] = key;
+    history->moves[slot] = move;
+    history->count++;
+}
+
+// index of the oldest move the ring still holds
+u32 history_first(const struct game_history *history) {
+    return history->count > GAME_HISTORY_SIZE ? history->count - GAME_HISTORY_SIZE : 0;
+}
+
+// copies up to max moves starting at the move with the given index, or at the oldest one kept if that is later
+// returns the number of moves copied and sets first to the index of the first of them
+u32 history_read(const struct game_history *history, u32 offset, u16 *moves, u32 max, u32 *first) {
+    u32 i, count = 0;
+
+    *first = offset > history_first(history) ? offset : history_first(history);
+    for (i = *first; i < history->count && count < max; i++) {
+        moves[count++] = history->moves[i % GAME_HISTORY_SIZE];
+    }
+    return count;
+}
+
+// counts the earlier positions, up to limit, that are the same as the current one with the same side to move
+// the moves made on the position are searched first and then the game history, which may be NULL
+// only positions since the last capture or pawn move can repeat, so the halfmove clock bounds the scan
+int count_repetitions(const struct position *pos, const struct game_history *history, int limit) {
+    int plies, count = 0;
+    u32 index;
+    u64 key;
+
+    for (plies = 2; plies <= pos->halfmove_clock && count < limit; plies += 2) {
+        if (plies <= pos->ply) {
+            key = pos->undo_stack[pos->ply - plies].key;
+        } else {
+            // the game history ends where the undo stack begins
+            index = plies - pos->ply;
+            if (!history || index > history->count - history_first(history)) {
+                break;
+            }
+            key = history->keys[(history->count - index) % GAME_HISTORY_SIZE];
+        }
+        count += key == pos->key;
+    }
+    return count;
+}
@@ -0,0 +1,129 @@
+/*
+description: builds a Polyglot opening book for the module from lines of moves played from the start position
+*/
+#include "engine.h"
+
+// builds an opening book for the module from opening lines, one line of moves from the start position per row
+// moves are written as origin and destination like e2e4, with the promoted piece appended like e7e8q
+// the book holds Polyglot keys and moves, so other Polyglot tools read it and the module reads their books
+// usage: ./chess_mkbook < lines.txt > chess_book.bin
+
+#define MAX_LINE_LEN 4096
+
+struct entry {
+    u64 key;
+    u16 move;
+    u32 weight;
+};
+
+static struct entry *entries;
+static size_t count, capacity;
+
+// book moves hold the destination in bits 0-5, the origin in bits 6-11, and the promoted type in bits 12-14
+// castling is written as the king taking its own rook, e1h1 for e1g1 and e1a1 for e1c1
+static u16 book_move(u16 move) {
+    u16 promoted = MOVE_FLAGS(move) & MOVE_PROMOTION ? MOVE_PROMOTED(move) - KNIGHT + 1 : 0;
+    u16 to = MOVE_TO(move);
+
+    if (MOVE_FLAGS(move) == MOVE_KING_CASTLE) {
+        to = MOVE_FROM(move) + 3;
+    } else if (MOVE_FLAGS(move) == MOVE_QUEEN_CASTLE) {
+        to = MOVE_FROM(move) - 4;
+    }
+    return to | MOVE_FROM(move) << 6 | promoted << 12;
+}
+
+static void add_entry(u64 key, u16 move) {
+    if (count == capacity) {
+        capacity = capacity ? capacity * 2 : 1024;
+        entries = realloc(entries, capacity * sizeof(*entries));
+        if (!entries) {
+            fprintf(stderr, "out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    entries[count].key = key;
+    entries[count].move = book_move(move);
+    entries[count++].weight = 1;
+}
+
+// parses a move like e2e4 or e7e8q into the legal move it stands for, returns 0 if there is none
+static u16 parse_coordinates(struct position *pos, const char *text) {
+    static const char promotions[] = "nbrq";
+    const char *promoted;
+    int flags = MOVE_QUIET;
+
+    if (strlen(text) < 4 || strlen(text) > 5 || text[0] < 'a' || text[0] > 'h' || text[1] < '1' || text[1] > '8' ||
+        text[2] < 'a' || text[2] > 'h' || text[3] < '1' || text[3] > '8') {
+        return 0;
+    }
+    if (text[4]) {
+        promoted = strchr(promotions, text[4]);
+        if (!promoted) {
+            return 0;
+        }
+        flags = MOVE_PROMOTION | (int)(promoted - promotions);
+    }
+    return find_legal_move(pos, MAKE_MOVE(SQUARE(text[1] - '1', text[0] - 'a'), SQUARE(text[3] - '1', text[2] - 'a'),
+                                          flags));
+}
+
+static int compare_entries(const void *a, const void *b) {
+    const struct entry *x = a, *y = b;
+
+    if (x->key != y->key) {
+        return x->key < y->key ? -1 : 1;
+    }
+    return (int)x->move - (int)y->move;
+}
+
+static void write_be(u64 value, int bytes) {
+    while (bytes--) {
+        putchar((int)(value >> (8 * bytes)) & 0xff);
+    }
+}
+
+int main(void) {
+    static struct position pos;
+    char line[MAX_LINE_LEN];
+    int line_number = 0, errors = 0;
+    size_t i, merged = 0;
+    char *token;
+    u16 move;
+
+    engine_init();
+    while (fgets(line, sizeof(line), stdin)) {
+        line_number++;
+        initialize_board(&pos);
+        for (token = strtok(line, " \t\r\n"); token && token[0] != '#'; token = strtok(NULL, " \t\r\n")) {
+            move = parse_coordinates(&pos, token);
+            if (!move) {
+                fprintf(stderr, "line %d: %s is not a legal move, the rest of the line is skipped\n", line_number,
+                        token);
+                errors++;
+                break;
+            }
+            add_entry(polyglot_key(&pos), move);
+            commit_move(&pos, move);
+        }
+    }
+
+    // the same move of the same position counts once for every line that plays it
+    qsort(entries, count, sizeof(*entries), compare_entries);
+    for (i = 0; i < count; i++) {
+        if (merged > 0 && entries[merged - 1].key == entries[i].key && entries[merged - 1].move == entries[i].move) {
+            entries[merged - 1].weight++;
+        } else {
+            entries[merged++] = entries[i];
+        }
+    }
+    for (i = 0; i < merged; i++) {
+        write_be(entries[i].key, 8);
+        write_be(entries[i].move, 2);
+        write_be(entries[i].weight < U16_MAX ? entries[i].weight : U16_MAX, 2);
+        write_be(0, 4); // learn field, unused
+    }
+    fprintf(stderr, "%zu entries from %d lines\n", merged, line_number);
+    free(entries);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
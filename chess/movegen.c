@@ -0,0 +1,357 @@
+/*
+description: pseudo-legal move generation, legal move generation from check and pin masks, and perft
+*/
+#include "engine.h"
+
+// appends a move, expanding promotions into one move per promoted piece
+static void add_move(struct move_list *list, int from, int to, int flags, bool promotion) {
+    int type;
+    if (!promotion) {
+        list->moves[list->count++] = MAKE_MOVE(from, to, flags);
+        return;
+    }
+    for (type = QUEEN; type >= KNIGHT; type--) {
+        list->moves[list->count++] = MAKE_MOVE(from, to, flags | MOVE_PROMOTION | (type - KNIGHT));
+    }
+}
+
+// appends a move from every source square implied by a set of destinations and a fixed offset
+static void add_pawn_moves(struct move_list *list, u64 targets, int offset, int flags) {
+    while (targets) {
+        int to = __ffs64(targets);
+        targets &= targets - 1;
+        add_move(list, to - offset, to, flags, (BIT_ULL(to) & (RANK_1 | RANK_8)) != 0);
+    }
+}
+
+// generates pawn captures, including captures that promote and en passant
+static void generate_pawn_captures(const struct position *pos, struct move_list *list) {
+    u64 pawns = pos->pieces[MAKE_PIECE(pos->side, PAWN)];
+    u64 enemies = pos->occupied[!pos->side];
+    u64 attackers;
+
+    // the pawns that could capture a pawn on the en passant square are the ones that take it in passing
+    if (pos->ep_square != NO_SQUARE) {
+        for (attackers = pawn_attacks[!pos->side][pos->ep_square] & pawns; attackers; attackers &= attackers - 1) {
+            add_move(list, __ffs64(attackers), pos->ep_square, MOVE_EN_PASSANT, false);
+        }
+    }
+
+    if (pos->side == WHITE) {
+        add_pawn_moves(list, ((pawns & ~FILE_A) << 7) & enemies, 7, MOVE_CAPTURE);
+        add_pawn_moves(list, ((pawns & ~FILE_H) << 9) & enemies, 9, MOVE_CAPTURE);
+    } else {
+        add_pawn_moves(list, ((pawns & ~FILE_H) >> 7) & enemies, -7, MOVE_CAPTURE);
+        add_pawn_moves(list, ((pawns & ~FILE_A) >> 9) & enemies, -9, MOVE_CAPTURE);
+    }
+}
+
+// generates single and double pawn pushes, including pushes that promote
+static void generate_pawn_pushes(const struct position *pos, struct move_list *list) {
+    u64 pawns = pos->pieces[MAKE_PIECE(pos->side, PAWN)];
+    u64 empty = ~pos->all;
+    u64 single, twice;
+
+    if (pos->side == WHITE) {
+        single = (pawns << 8) & empty;
+        twice = ((single & RANK_3) << 8) & empty;
+        add_pawn_moves(list, single, 8, MOVE_QUIET);
+        add_pawn_moves(list, twice, 16, MOVE_DOUBLE_PUSH);
+    } else {
+        single = (pawns >> 8) & empty;
+        twice = ((single & RANK_6) >> 8) & empty;
+        add_pawn_moves(list, single, -8, MOVE_QUIET);
+        add_pawn_moves(list, twice, -16, MOVE_DOUBLE_PUSH);
+    }
+}
+
+// generates knight, bishop, rook, queen, and king moves that land on the target mask
+static void generate_piece_moves(const struct position *pos, struct move_list *list, u64 target_mask) {
+    u64 pieces = pos->occupied[pos->side] & ~pos->pieces[MAKE_PIECE(pos->side, PAWN)];
+    u64 enemies = pos->occupied[!pos->side];
+
+    while (pieces) {
+        int from = __ffs64(pieces);
+        u64 targets = 0;
+        pieces &= pieces - 1;
+
+        switch (PIECE_TYPE(pos->board[from])) {
+        case KNIGHT:
+            targets = knight_attacks[from];
+            break;
+        case BISHOP:
+            targets = bishop_attacks(from, pos->all);
+            break;
+        case ROOK:
+            targets = rook_attacks(from, pos->all);
+            break;
+        case QUEEN:
+            targets = bishop_attacks(from, pos->all) | rook_attacks(from, pos->all);
+            break;
+        case KING:
+            targets = king_attacks[from];
+            break;
+        }
+
+        for (targets &= target_mask; targets; targets &= targets - 1) {
+            int to = __ffs64(targets);
+            add_move(list, from, to, (enemies & BIT_ULL(to)) ? MOVE_CAPTURE : MOVE_QUIET, false);
+        }
+    }
+}
+
+// determines if the side to move may castle to one side: the right is left, the squares between king and rook
+// are empty, and the king is not in check and does not cross an attacked square
+// landing on an attacked square is left to the legality check like any other king move
+static bool can_castle(const struct position *pos, int flags) {
+    int king = pos->side == WHITE ? SQUARE(0, 4) : SQUARE(7, 4);
+    int right = flags == MOVE_KING_CASTLE ? CASTLE_WHITE_KING : CASTLE_WHITE_QUEEN;
+    int rook = flags == MOVE_KING_CASTLE ? king + 3 : king - 4;
+    int crossed = flags == MOVE_KING_CASTLE ? king + 1 : king - 1;
+
+    // black's rights are white's shifted up two bits
+    return (pos->castling & (right << (2 * pos->side))) && !(pos->all & between_mask[king][rook]) &&
+           !square_attacked_by(pos, !pos->side, king) && !square_attacked_by(pos, !pos->side, crossed);
+}
+
+// generates the castling moves of the side to move, written as the king's two square move
+static void generate_castling(const struct position *pos, struct move_list *list) {
+    int king = pos->side == WHITE ? SQUARE(0, 4) : SQUARE(7, 4);
+
+    if (can_castle(pos, MOVE_KING_CASTLE)) {
+        add_move(list, king, king + 2, MOVE_KING_CASTLE, false);
+    }
+    if (can_castle(pos, MOVE_QUEEN_CASTLE)) {
+        add_move(list, king, king - 2, MOVE_QUEEN_CASTLE, false);
+    }
+}
+
+// generates only the pseudo-legal captures for the side to move
+void generate_captures(const struct position *pos, struct move_list *list) {
+    list->count = 0;
+    generate_pawn_captures(pos, list);
+    generate_piece_moves(pos, list, pos->occupied[!pos->side]);
+}
+
+// generates the captures and the pushes that promote, the moves that change the material on the board
+void generate_tactical(const struct position *pos, struct move_list *list) {
+    u64 pawns = pos->pieces[MAKE_PIECE(pos->side, PAWN)];
+    u64 empty = ~pos->all;
+
+    generate_captures(pos, list);
+    if (pos->side == WHITE) {
+        add_pawn_moves(list, (pawns << 8) & empty & RANK_8, 8, MOVE_QUIET);
+    } else {
+        add_pawn_moves(list, (pawns >> 8) & empty & RANK_1, -8, MOVE_QUIET);
+    }
+}
+
+// generates every pseudo-legal move for the side to move, captures first so the search tries them early
+void generate_moves(const struct position *pos, struct move_list *list) {
+    generate_captures(pos, list);
+    generate_pawn_pushes(pos, list);
+    generate_piece_moves(pos, list, ~pos->all);
+    generate_castling(pos, list);
+}
+
+// generates the pseudo-legal moves that capture nothing, pushes that promote included
+void generate_quiets(const struct position *pos, struct move_list *list) {
+    list->count = 0;
+    generate_pawn_pushes(pos, list);
+    generate_piece_moves(pos, list, ~pos->all);
+    generate_castling(pos, list);
+}
+
+// determines if a move, typically remembered from another position, is one generate_moves() would make here
+bool move_is_pseudo_legal(const struct position *pos, u16 move) {
+    int from = MOVE_FROM(move), to = MOVE_TO(move), flags = MOVE_FLAGS(move);
+    int piece = pos->board[from];
+    int forward = pos->side == WHITE ? BOARD_SIZE : -BOARD_SIZE;
+    bool capture = (pos->occupied[!pos->side] & BIT_ULL(to)) != 0;
+    bool last_rank = (BIT_ULL(to) & (RANK_1 | RANK_8)) != 0;
+    u64 targets;
+
+    if (piece == NO_PIECE || PIECE_COLOR(piece) != pos->side) {
+        return false;
+    }
+    // the two moves whose destination does not tell what they capture or move
+    if (flags == MOVE_EN_PASSANT) {
+        return PIECE_TYPE(piece) == PAWN && to == pos->ep_square && (pawn_attacks[pos->side][from] & BIT_ULL(to));
+    }
+    if (flags == MOVE_KING_CASTLE || flags == MOVE_QUEEN_CASTLE) {
+        return PIECE_TYPE(piece) == KING && from == (pos->side == WHITE ? SQUARE(0, 4) : SQUARE(7, 4)) &&
+               to == (flags == MOVE_KING_CASTLE ? from + 2 : from - 2) && can_castle(pos, flags);
+    }
+    if ((pos->occupied[pos->side] & BIT_ULL(to)) || !!(flags & MOVE_CAPTURE) != capture) {
+        return false;
+    }
+    if (PIECE_TYPE(piece) != PAWN) {
+        if (flags & ~MOVE_CAPTURE) {
+            return false;
+        }
+        switch (PIECE_TYPE(piece)) {
+        case KNIGHT:
+            targets = knight_attacks[from];
+            break;
+        case BISHOP:
+            targets = bishop_attacks(from, pos->all);
+            break;
+        case ROOK:
+            targets = rook_attacks(from, pos->all);
+            break;
+        case QUEEN:
+            targets = bishop_attacks(from, pos->all) | rook_attacks(from, pos->all);
+            break;
+        default:
+            targets = king_attacks[from];
+            break;
+        }
+        return (targets & BIT_ULL(to)) != 0;
+    }
+
+    // pawns promote exactly when they reach the last rank, otherwise only a quiet double push has other flags
+    if (!!(flags & MOVE_PROMOTION) != last_rank ||
+        (!(flags & MOVE_PROMOTION) && (flags & 0x3) && flags != MOVE_DOUBLE_PUSH)) {
+        return false;
+    }
+    if (capture) {
+        return (pawn_attacks[pos->side][from] & BIT_ULL(to)) != 0;
+    }
+    if (flags == MOVE_DOUBLE_PUSH) {
+        return to == from + 2 * forward && SQ_ROW(from) == (pos->side == WHITE ? 1 : BOARD_SIZE - 2) &&
+               pos->board[from + forward] == NO_PIECE;
+    }
+    return to == from + forward && pos->board[to] == NO_PIECE;
+}
+
+// finds the pieces giving check and the pieces pinned to the king of the side to move, and the destinations
+// that answer a single check, so the legality of every move of the position is a few mask tests
+void compute_legality(const struct position *pos, struct legality *legality) {
+    const u64 *theirs = &pos->pieces[MAKE_PIECE(!pos->side, PAWN)];
+    int king = king_square(pos, pos->side);
+    u64 snipers, blockers, checkers;
+
+    checkers = attackers_to(pos, king, pos->all) & pos->occupied[!pos->side];
+    legality->king = king;
+    legality->checkers = checkers;
+
+    // a slider that would attack the king if only its own side's pieces stood in the way pins a lone blocker
+    legality->pinned = 0;
+    snipers = (rook_attacks(king, pos->occupied[!pos->side]) & (theirs[ROOK] | theirs[QUEEN])) |
+              (bishop_attacks(king, pos->occupied[!pos->side]) & (theirs[BISHOP] | theirs[QUEEN]));
+    for (; snipers; snipers &= snipers - 1) {
+        blockers = between_mask[king][__ffs64(snipers)] & pos->all;
+        if (blockers && !(blockers & (blockers - 1)) && (blockers & pos->occupied[pos->side])) {
+            legality->pinned |= blockers;
+        }
+    }
+
+    // a single check is answered by taking the checker or blocking its ray, a double check only by the king
+    if (!checkers) {
+        legality->evasions = ~0ULL;
+    } else if (checkers & (checkers - 1)) {
+        legality->evasions = 0;
+    } else {
+        legality->evasions = checkers | between_mask[king][__ffs64(checkers)];
+    }
+}
+
+// determines if a pseudo-legal move of the position the masks were computed for keeps the mover's king safe
+bool move_is_legal(const struct position *pos, const struct legality *legality, u16 move) {
+    int from = MOVE_FROM(move), to = MOVE_TO(move), king = legality->king;
+    u64 occupied;
+
+    // the king may not step onto an attacked square, and it no longer hides the squares behind it from a slider
+    // castling already checked the squares the king starts on and crosses
+    if (from == king) {
+        return !(attackers_to(pos, to, pos->all ^ BIT_ULL(from)) & pos->occupied[!pos->side]);
+    }
+    // en passant takes two pieces off one rank at once, so the position after it is checked as a whole
+    if (MOVE_FLAGS(move) == MOVE_EN_PASSANT) {
+        int victim = pos->side == WHITE ? to - BOARD_SIZE : to + BOARD_SIZE;
+        occupied = (pos->all ^ BIT_ULL(from) ^ BIT_ULL(victim)) | BIT_ULL(to);
+        return !(attackers_to(pos, king, occupied) & pos->occupied[!pos->side] & ~BIT_ULL(victim));
+    }
+    if (!(legality->evasions & BIT_ULL(to))) {
+        return false;
+    }
+    // a pinned piece stays on the line through its king and the pinner, between them or taking the pinner
+    return !(legality->pinned & BIT_ULL(from)) || (between_mask[king][from] & BIT_ULL(to)) ||
+           (between_mask[king][to] & BIT_ULL(from));
+}
+
+// removes the moves from a list of pseudo-legal moves that would leave the mover's king in check
+void filter_legal(const struct position *pos, struct move_list *list) {
+    struct legality legality;
+    int i, count = 0;
+
+    compute_legality(pos, &legality);
+    for (i = 0; i < list->count; i++) {
+        if (move_is_legal(pos, &legality, list->moves[i])) {
+            list->moves[count++] = list->moves[i];
+        }
+    }
+    list->count = count;
+}
+
+// generates every legal move for the side to move
+void generate_legal(const struct position *pos, struct move_list *list) {
+    generate_moves(pos, list);
+    filter_legal(pos, list);
+}
+
+// counts the leaves of the legal move tree to the given depth, the moves of the last level are counted without making them
+// lists holds the moves of each level, depth of them, so the recursion keeps none on the stack
+u64 perft(struct position *pos, int depth, struct move_list *lists) {
+    struct move_list *list = &lists[depth - 1];
+    u64 nodes = 0;
+    int i;
+
+    generate_legal(pos, list);
+    if (depth <= 1) {
+        return list->count;
+    }
+    // deep perfts take seconds, so let other tasks run now and then
+    if (depth >= 3) {
+        cond_resched();
+    }
+    for (i = 0; i < list->count; i++) {
+        make_move(pos, list->moves[i]);
+        nodes += perft(pos, depth - 1, lists);
+        unmake_move(pos);
+    }
+    return nodes;
+}
+
+// fills in the flags generate_moves() would give a move with the squares and promotion of a packed move
+static u16 complete_move(const struct position *pos, u16 move) {
+    int from = MOVE_FROM(move), to = MOVE_TO(move), type = PIECE_TYPE(pos->board[from]);
+    int flags = MOVE_QUIET;
+
+    if (MOVE_FLAGS(move) & MOVE_PROMOTION) {
+        flags = MOVE_FLAGS(move) & (MOVE_PROMOTION | 0x3);
+    } else if (type == PAWN && abs(to - from) == 2 * BOARD_SIZE) {
+        flags = MOVE_DOUBLE_PUSH;
+    } else if (type == PAWN && to == pos->ep_square && SQ_COL(to) != SQ_COL(from)) {
+        flags = MOVE_EN_PASSANT;
+    } else if (type == KING && abs(to - from) == 2) {
+        flags = to > from ? MOVE_KING_CASTLE : MOVE_QUEEN_CASTLE;
+    }
+    if (pos->board[to] != NO_PIECE) {
+        flags |= MOVE_CAPTURE;
+    }
+    return MAKE_MOVE(from, to, flags);
+}
+
+// function to find the legal move with the from square, to square, and promotion of a packed move, returns 0 if none
+// the other flags are ignored, the returned move carries the ones the generator would give it
+u16 find_legal_move(const struct position *pos, u16 move) {
+    struct legality legality;
+
+    move = complete_move(pos, move);
+    if (!move_is_pseudo_legal(pos, move)) {
+        return 0;
+    }
+    compute_legality(pos, &legality);
+    return move_is_legal(pos, &legality, move) ? move : 0;
+}
@@ -0,0 +1,222 @@
+/*
+description: move ordering: MVV-LVA and exchange evaluation for captures, killer moves and history for quiet moves, and a
+staged move picker
+*/
+#include "engine.h"
+
+// stages of the move picker, each one generates or hands out one kind of move
+enum {
+    STAGE_HASH,
+    STAGE_GENERATE_CAPTURES,
+    STAGE_CAPTURES,
+    STAGE_FIRST_KILLER,
+    STAGE_SECOND_KILLER,
+    STAGE_GENERATE_QUIETS,
+    STAGE_QUIETS,
+    STAGE_BAD_CAPTURES,
+    STAGE_GENERATE_TACTICAL, // the quiescence search starts here
+    STAGE_TACTICAL,
+    STAGE_DONE,
+};
+
+// quiet promotions are tried before any quiet move the history knows
+#define PROMOTION_SCORE (HISTORY_MAX + 1)
+
+// most valuable victim first, and of the captures of one victim the least valuable attacker first
+static int mvv_lva(const struct position *pos, u16 move) {
+    int victim = PIECE_TYPE(pos->board[MOVE_TO(move)]);
+    int attacker = PIECE_TYPE(pos->board[MOVE_FROM(move)]);
+    int score = victim * PIECE_TYPES + KING - attacker;
+
+    if (MOVE_FLAGS(move) & MOVE_PROMOTION) {
+        score += MOVE_PROMOTED(move) * PIECE_TYPES; // a capture that promotes also gains the new piece
+    }
+    return score;
+}
+
+// history score of a quiet move, indexed by the piece moving and its destination
+static int quiet_score(const struct move_picker *picker, u16 move) {
+    if (MOVE_FLAGS(move) & MOVE_PROMOTION) {
+        return PROMOTION_SCORE + MOVE_PROMOTED(move);
+    }
+    return picker->order->history[picker->pos->board[MOVE_FROM(move)]][MOVE_TO(move)];
+}
+
+// determines if a capture loses material, only a capture by a piece worth more than its victim can
+static bool loses_material(const struct position *pos, u16 move) {
+    int victim = pos->board[MOVE_TO(move)];
+    int attacker = PIECE_TYPE(pos->board[MOVE_FROM(move)]);
+
+    if (victim != NO_PIECE && piece_values[attacker] <= piece_values[PIECE_TYPE(victim)]) {
+        return false;
+    }
+    return see(pos, move) < 0;
+}
+
+// hands out the best scored move not handed out yet, selection sort one move at a time
+static u16 pick_best(struct move_picker *picker) {
+    struct move_list *list = &picker->list;
+    int i, best = picker->index;
+    s16 score;
+    u16 move;
+
+    if (picker->index >= list->count) {
+        return 0;
+    }
+    for (i = picker->index + 1; i < list->count; i++) {
+        if (picker->scores[i] > picker->scores[best]) {
+            best = i;
+        }
+    }
+    move = list->moves[best];
+    score = picker->scores[best];
+    list->moves[best] = list->moves[picker->index];
+    picker->scores[best] = picker->scores[picker->index];
+    list->moves[picker->index] = move;
+    picker->scores[picker->index++] = score;
+    return move;
+}
+
+// determines if a quiet move was already handed out as the hash move or a killer
+static bool already_tried(const struct move_picker *picker, u16 move) {
+    return move == picker->hash_move || move == picker->killers[0] || move == picker->killers[1];
+}
+
+// prepares to hand out the moves of a position, starting with the hash move if it can be played there
+void picker_init(struct move_picker *picker, const struct position *pos, const struct move_order *order,
+                 u16 hash_move) {
+    picker->pos = pos;
+    picker->order = order;
+    picker->stage = STAGE_HASH;
+    picker->index = 0;
+    picker->list.count = 0;
+    picker->hash_move = hash_move && move_is_pseudo_legal(pos, hash_move) ? hash_move : 0;
+    picker->killers[0] = 0;
+    picker->killers[1] = 0;
+    picker->bad_count = 0;
+}
+
+// prepares to hand out only the captures and queen promotions that do not lose material, best first
+void picker_init_quiescence(struct move_picker *picker, const struct position *pos) {
+    picker_init(picker, pos, NULL, 0);
+    picker->stage = STAGE_GENERATE_TACTICAL;
+}
+
+// returns the next pseudo-legal move to try, or 0 once every move has been handed out
+u16 picker_next(struct move_picker *picker) {
+    const struct position *pos = picker->pos;
+    u16 move;
+    int i;
+
+    switch (picker->stage) {
+    case STAGE_HASH:
+        picker->stage = STAGE_GENERATE_CAPTURES;
+        if (picker->hash_move) {
+            return picker->hash_move;
+        }
+        fallthrough;
+    case STAGE_GENERATE_CAPTURES:
+        generate_captures(pos, &picker->list);
+        for (i = 0; i < picker->list.count; i++) {
+            picker->scores[i] = mvv_lva(pos, picker->list.moves[i]);
+        }
+        picker->stage = STAGE_CAPTURES;
+        fallthrough;
+    case STAGE_CAPTURES:
+        while ((move = pick_best(picker))) {
+            if (move == picker->hash_move) {
+                continue;
+            }
+            if (picker->bad_count < MAX_BAD_CAPTURES && loses_material(pos, move)) {
+                picker->bad_captures[picker->bad_count++] = move; // tried after the quiet moves
+                continue;
+            }
+            return move;
+        }
+        picker->stage = STAGE_FIRST_KILLER;
+        fallthrough;
+    case STAGE_FIRST_KILLER:
+    case STAGE_SECOND_KILLER:
+        // killers are quiet moves that refuted a sibling position, so they may not even be possible here
+        while (picker->stage != STAGE_GENERATE_QUIETS) {
+            int slot = picker->stage - STAGE_FIRST_KILLER;
+            move = pos->ply < MAX_PLY ? picker->order->killers[pos->ply][slot] : 0;
+            picker->stage++;
+            if (move && move != picker->hash_move && move_is_pseudo_legal(pos, move)) {
+                picker->killers[slot] = move;
+                return move;
+            }
+        }
+        fallthrough;
+    case STAGE_GENERATE_QUIETS:
+        generate_quiets(pos, &picker->list);
+        for (i = 0; i < picker->list.count; i++) {
+            picker->scores[i] = quiet_score(picker, picker->list.moves[i]);
+        }
+        picker->index = 0;
+        picker->stage = STAGE_QUIETS;
+        fallthrough;
+    case STAGE_QUIETS:
+        while ((move = pick_best(picker))) {
+            if (!already_tried(picker, move)) {
+                return move;
+            }
+        }
+        picker->index = 0;
+        picker->stage = STAGE_BAD_CAPTURES;
+        fallthrough;
+    case STAGE_BAD_CAPTURES:
+        // kept in the order they were picked, so the least bad comes first
+        if (picker->index < picker->bad_count) {
+            return picker->bad_captures[picker->index++];
+        }
+        picker->stage = STAGE_DONE;
+        return 0;
+    case STAGE_GENERATE_TACTICAL:
+        generate_tactical(pos, &picker->list);
+        for (i = 0; i < picker->list.count; i++) {
+            picker->scores[i] = mvv_lva(pos, picker->list.moves[i]);
+        }
+        picker->stage = STAGE_TACTICAL;
+        fallthrough;
+    case STAGE_TACTICAL:
+        // underpromotions and losing captures rarely change the outcome, so they are not searched at all
+        while ((move = pick_best(picker))) {
+            if ((MOVE_FLAGS(move) & MOVE_PROMOTION) && MOVE_PROMOTED(move) != QUEEN) {
+                continue;
+            }
+            if (!loses_material(pos, move)) {
+                return move;
+            }
+        }
+        picker->stage = STAGE_DONE;
+        fallthrough;
+    default:
+        return 0;
+    }
+}
+
+// remembers a quiet move that caused a beta cutoff as a killer of its ply and raises its history
+void order_update(struct move_order *order, const struct position *pos, u16 move, int depth) {
+    int piece = pos->board[MOVE_FROM(move)];
+    int to = MOVE_TO(move);
+    int i, j;
+
+    if (MOVE_FLAGS(move) & (MOVE_CAPTURE | MOVE_PROMOTION)) {
+        return; // captures and promotions are ordered well without help
+    }
+    if (pos->ply < MAX_PLY && order->killers[pos->ply][0] != move) {
+        order->killers[pos->ply][1] = order->killers[pos->ply][0];
+        order->killers[pos->ply][0] = move;
+    }
+
+    // deep cutoffs say more than shallow ones, halve every score once one would overflow
+    order->history[piece][to] += depth * depth;
+    if (order->history[piece][to] > HISTORY_MAX) {
+        for (i = 0; i < NUM_PIECES; i++) {
+            for (j = 0; j < NUM_SQUARES; j++) {
+                order->history[i][j] /= 2;
+            }
+        }
+    }
+}
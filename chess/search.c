@@ -0,0 +1,513 @@
+/*
+description: iterative deepening alpha-beta search of the CPU move, run by several threads sharing one transposition
+table without locks (lazy SMP)
+*/
+#include "engine.h"
+
+#define SEARCH_CHECK_INTERVAL 1024 // nodes between checks of the time budget
+
+// transposition table entries pack the best move, score, depth, bound type, and search age into 64 bits
+#define TT_BUCKET_SIZE 4 // entries sharing one cache line
+#define TT_BOUND_UPPER 1
+#define TT_BOUND_LOWER 2
+#define TT_BOUND_EXACT 3
+#define TT_AGE_MASK 0x3f
+#define TT_PACK(move, score, depth, bound, age) \
+    ((u64)(move) | ((u64)(u16)(score) << 16) | ((u64)(depth) << 32) | ((u64)(bound) << 40) | ((u64)(age) << 42))
+#define TT_MOVE(data) ((u16)(data))
+#define TT_SCORE(data) ((s16)((data) >> 16))
+#define TT_DEPTH(data) ((int)(((data) >> 32) & 0xff))
+#define TT_BOUND(data) ((int)(((data) >> 40) & 0x3))
+#define TT_AGE(data) ((int)(((data) >> 42) & TT_AGE_MASK))
+
+// transposition table slot, the check word is the key xored with the data so a torn entry never matches
+struct tt_entry {
+    u64 check;
+    u64 data;
+};
+
+// state of one search for the CPU move
+struct search {
+    struct position *pos;
+    const struct game_history *history; // moves of the game before the root position, NULL if unknown
+    u64 nodes;      // positions visited
+    u64 next_check; // node count at which the time budget is checked again
+    u64 start;      // ktime in nanoseconds when the search started
+    u64 deadline;   // ktime in nanoseconds when the search has to stop
+    bool stopped;   // set once the budget is spent
+    const bool *cancel; // set by another thread to stop the search early
+    const bool *abort;  // set once the main thread of a parallel search is done, NULL in the main thread
+    u16 best_move;  // best root move of the last completed iteration
+    int best_score;
+    int depth;      // depth of the last completed iteration
+    u64 depth_ns[MAX_SEARCH_DEPTH + 1]; // time from the start until each iteration was completed
+    u8 age;         // transposition table age of this search
+    u64 tt_hits;    // transposition table statistics, added to the totals when the search ends
+    u64 tt_misses;
+    u64 tt_collisions;
+    u64 cutoffs;    // moves that failed high
+    struct move_order order; // killers and history, too large for the stack so the search is allocated
+    struct move_picker *pickers; // one per ply, the moves of each node of the current line live here, not on the stack
+};
+
+// one thread of a parallel search, a helper searches its own copy of the root position
+struct search_thread {
+    struct search search;
+    struct position pos;
+    struct move_list root;
+    int first_depth;          // odd helpers skip depth 1, so the helpers are not all on the same iteration
+    int max_depth;
+    struct completion done;   // completed when the helper has returned its results
+};
+
+// memory of the searches of one game, allocated once so that a CPU move allocates nothing
+struct search_workspace {
+    unsigned int threads;         // threads searching each move, fixed when the workspace is allocated
+    struct search_thread *pool;
+    struct move_picker *pickers;  // MAX_PLY for each thread
+};
+
+// variables
+static struct tt_entry *tt_table;     // transposition table shared by every search
+static u64 tt_mask;                   // number of buckets minus one
+static u8 tt_age;                     // bumped by every search so stale entries are replaced first
+atomic64_t tt_hits = ATOMIC64_INIT(0);
+atomic64_t tt_misses = ATOMIC64_INIT(0);
+atomic64_t tt_collisions = ATOMIC64_INIT(0);
+atomic64_t search_nodes = ATOMIC64_INIT(0);
+atomic64_t search_time_ns = ATOMIC64_INIT(0);
+atomic64_t search_count = ATOMIC64_INIT(0);
+atomic64_t search_depths = ATOMIC64_INIT(0);
+static unsigned int smp_threads = 1;  // threads of the workspaces allocated from now on
+
+// stops the search once its budget is spent, and lets the scheduler run other tasks while it thinks
+static bool search_should_stop(struct search *search) {
+    if (!search->stopped && search->nodes >= search->next_check) {
+        search->next_check = search->nodes + SEARCH_CHECK_INTERVAL;
+        cond_resched();
+        if (ktime_get_ns() >= search->deadline || READ_ONCE(*search->cancel) ||
+            (search->abort && READ_ONCE(*search->abort))) {
+            search->stopped = true;
+        }
+    }
+    return search->stopped;
+}
+
+// finds the entry stored for a position in the transposition table, returns its data or 0 when absent
+static u64 tt_probe(struct search *search, u64 key) {
+    struct tt_entry *bucket;
+    u64 data;
+    int i;
+
+    if (!tt_table) {
+        return 0;
+    }
+    bucket = &tt_table[(key & tt_mask) * TT_BUCKET_SIZE];
+    for (i = 0; i < TT_BUCKET_SIZE; i++) {
+        data = READ_ONCE(bucket[i].data);
+        if (data && (READ_ONCE(bucket[i].check) ^ data) == key) {
+            search->tt_hits++;
+            return data;
+        }
+    }
+    search->tt_misses++;
+    return 0;
+}
+
+// how much an entry is worth keeping, deep entries from recent searches are worth the most
+static int tt_entry_worth(struct search *search, u64 data) {
+    if (!data) {
+        return -INFINITE_SCORE; // empty slot
+    }
+    return TT_DEPTH(data) - 4 * ((search->age - TT_AGE(data)) & TT_AGE_MASK);
+}
+
+// stores a search result, replacing the entry of the same position or else the least valuable one in its bucket
+static void tt_store(struct search *search, u64 key, u16 move, int score, int depth, int bound) {
+    struct tt_entry *bucket, *replace;
+    u64 data, old;
+    int i;
+
+    if (!tt_table) {
+        return;
+    }
+    bucket = &tt_table[(key & tt_mask) * TT_BUCKET_SIZE];
+    replace = &bucket[0];
+    for (i = 0; i < TT_BUCKET_SIZE; i++) {
+        old = READ_ONCE(bucket[i].data);
+        if (old && (READ_ONCE(bucket[i].check) ^ old) == key) {
+            replace = &bucket[i];
+            if (!move) {
+                move = TT_MOVE(old); // keep the best move found by an earlier search
+            }
+            break;
+        }
+        if (tt_entry_worth(search, old) < tt_entry_worth(search, READ_ONCE(replace->data))) {
+            replace = &bucket[i];
+        }
+    }
+    if (i == TT_BUCKET_SIZE && READ_ONCE(replace->data)) {
+        search->tt_collisions++; // another position's entry is evicted
+    }
+
+    // mate scores are stored relative to this position rather than the root
+    if (score >= MATE_SCORE - MAX_PLY) {
+        score += search->pos->ply;
+    } else if (score <= -MATE_SCORE + MAX_PLY) {
+        score -= search->pos->ply;
+    }
+    data = TT_PACK(move, score, depth, bound, search->age);
+    WRITE_ONCE(replace->data, data);
+    WRITE_ONCE(replace->check, key ^ data);
+}
+
+// score of an entry as seen from the current ply
+static int tt_score(struct search *search, u64 data) {
+    int score = TT_SCORE(data);
+    if (score >= MATE_SCORE - MAX_PLY) {
+        score -= search->pos->ply;
+    } else if (score <= -MATE_SCORE + MAX_PLY) {
+        score += search->pos->ply;
+    }
+    return score;
+}
+
+// searches the captures and queen promotions of a position until it is quiet, so the depth limit never stops the
+// search in the middle of an exchange; the side to move may also stand pat on the static evaluation unless in check
+static int quiescence(struct search *search, int alpha, int beta) {
+    struct position *pos = search->pos;
+    struct move_picker *picker;
+    struct legality legality;
+    bool in_check;
+    int score, legal_moves = 0;
+    u16 move;
+
+    search->nodes++;
+    if (pos->ply >= MAX_PLY - 1) {
+        return evaluate(pos);
+    }
+    compute_legality(pos, &legality);
+    in_check = legality.checkers != 0;
+    picker = &search->pickers[pos->ply];
+
+    // in check every evasion is searched, since standing pat may not be possible
+    if (in_check) {
+        picker_init(picker, pos, &search->order, 0);
+    } else {
+        score = evaluate(pos);
+        if (score >= beta) {
+            search->cutoffs++;
+            return score;
+        }
+        if (score > alpha) {
+            alpha = score;
+        }
+        picker_init_quiescence(picker, pos);
+    }
+
+    while ((move = picker_next(picker))) {
+        if (!move_is_legal(pos, &legality, move)) {
+            continue;
+        }
+        legal_moves++;
+        make_move(pos, move);
+        score = -quiescence(search, -beta, -alpha);
+        unmake_move(pos);
+
+        if (search_should_stop(search)) {
+            return 0;
+        }
+        if (score > alpha) {
+            alpha = score;
+            if (alpha >= beta) {
+                search->cutoffs++;
+                break;
+            }
+        }
+    }
+
+    if (in_check && legal_moves == 0) {
+        return -MATE_SCORE + pos->ply;
+    }
+    return alpha;
+}
+
+// negamax search with alpha-beta pruning, scores are from the point of view of the side to move
+static int negamax(struct search *search, int depth, int alpha, int beta) {
+    struct position *pos = search->pos;
+    struct move_picker *picker = &search->pickers[pos->ply];
+    struct legality legality;
+    int score, legal_moves = 0;
+    int bound = TT_BOUND_UPPER;
+    u16 move, best_move = 0;
+    u64 entry;
+
+    if (depth == 0) {
+        return quiescence(search, alpha, beta);
+    }
+    search->nodes++;
+    if (pos->ply >= MAX_PLY - 1) {
+        return evaluate(pos);
+    }
+
+    // a position that repeats one before it, in the search or in the game, is scored as a draw, as is one
+    // reached after fifty moves by each side without a capture or pawn move or one where neither side can mate
+    if (pos->halfmove_clock >= FIFTY_MOVE_PLIES || count_repetitions(pos, search->history, 1) ||
+        insufficient_material(pos)) {
+        return 0;
+    }
+
+    // reuse the result of an earlier search of this position when it was deep enough
+    entry = tt_probe(search, pos->key);
+    if (entry && TT_DEPTH(entry) >= depth) {
+        score = tt_score(search, entry);
+        if (TT_BOUND(entry) == TT_BOUND_EXACT ||
+            (TT_BOUND(entry) == TT_BOUND_LOWER && score >= beta) ||
+            (TT_BOUND(entry) == TT_BOUND_UPPER && score <= alpha)) {
+            return score;
+        }
+    }
+
+    // the stored best move is the most likely to cut off, so the picker hands it out first
+    compute_legality(pos, &legality);
+    picker_init(picker, pos, &search->order, entry ? TT_MOVE(entry) : 0);
+    while ((move = picker_next(picker))) {
+        if (!move_is_legal(pos, &legality, move)) {
+            continue;
+        }
+        legal_moves++;
+        make_move(pos, move);
+        score = -negamax(search, depth - 1, -beta, -alpha);
+        unmake_move(pos);
+
+        if (search_should_stop(search)) {
+            return 0;
+        }
+        if (score > alpha) {
+            alpha = score;
+            best_move = move;
+            bound = TT_BOUND_EXACT;
+            if (alpha >= beta) {
+                bound = TT_BOUND_LOWER;
+                search->cutoffs++;
+                order_update(&search->order, pos, move, depth);
+                break; // the opponent will avoid this position
+            }
+        }
+    }
+
+    // no legal moves means checkmate or stalemate
+    if (legal_moves == 0) {
+        if (legality.checkers) {
+            return -MATE_SCORE + pos->ply;
+        }
+        return 0;
+    }
+    tt_store(search, pos->key, best_move, alpha, depth, bound);
+    return alpha;
+}
+
+// searches the root moves to the given depth, trying the best move of the previous iteration first
+static void search_root(struct search *search, struct move_list *root, int depth) {
+    int i, score, alpha = -INFINITE_SCORE;
+    u16 best_move = 0;
+
+    for (i = 0; i < root->count; i++) {
+        make_move(search->pos, root->moves[i]);
+        score = -negamax(search, depth - 1, -INFINITE_SCORE, -alpha);
+        unmake_move(search->pos);
+        if (search->stopped) {
+            return; // keep the result of the last completed iteration
+        }
+        if (score > alpha) {
+            alpha = score;
+            best_move = root->moves[i];
+            // move it to the front so the next iteration searches it first
+            memmove(&root->moves[1], &root->moves[0], i * sizeof(root->moves[0]));
+            root->moves[0] = best_move;
+        }
+    }
+    search->best_move = best_move;
+    search->best_score = alpha;
+    search->depth = depth;
+    // deeper iterations than the counters hold are only asked for by the benchmark
+    if (depth <= MAX_SEARCH_DEPTH) {
+        search->depth_ns[depth] = ktime_get_ns() - search->start;
+    }
+}
+
+// deepens the search one iteration at a time until it reaches the maximum depth or is stopped
+static void iterate(struct search *search, struct move_list *root, int first_depth, int max_depth) {
+    int depth;
+
+    for (depth = first_depth; depth <= max_depth && !search->stopped; depth++) {
+        search_root(search, root, depth);
+        if (search->best_score >= MATE_SCORE - MAX_PLY) {
+            break; // a forced mate was found, deeper searches cannot improve it
+        }
+    }
+}
+
+// body of a helper thread, which only contributes through the entries it stores in the transposition table
+// unless it finishes a deeper iteration than the main thread
+static int search_helper(void *data) {
+    struct search_thread *thread = data;
+
+    iterate(&thread->search, &thread->root, thread->first_depth, thread->max_depth);
+    kthread_complete_and_exit(&thread->done, 0);
+}
+
+// finds the best move with iterative deepening, bounded by the difficulty's depth and time budget
+// the calling thread is the main thread, helpers search the same root until it is done
+// the counters of every thread are added up in stats
+u16 search_best_move(struct search_workspace *workspace, struct position *pos, const struct game_history *history,
+                     struct move_list *root, int max_depth, int time_ms, const bool *cancel,
+                     struct search_stats *stats) {
+    unsigned int i, started, threads = workspace->threads;
+    int depth;
+    struct search_thread *pool = workspace->pool;
+    struct search *search, *best;
+    u64 start = ktime_get_ns();
+    bool abort = false;
+    u8 age;
+
+    memset(stats, 0, sizeof(*stats));
+    // killers, history, and counters start from zero, the pickers are set up by each node
+    memset(pool, 0, threads * sizeof(*pool));
+
+    // searches of other games may bump the age at the same time, losing a bump only delays aging
+    age = (READ_ONCE(tt_age) + 1) & TT_AGE_MASK;
+    WRITE_ONCE(tt_age, age);
+    for (i = 0; i < threads; i++) {
+        search = &pool[i].search;
+        search->pos = i ? &pool[i].pos : pos;
+        search->history = history;
+        search->cancel = cancel;
+        search->abort = i ? &abort : NULL;
+        search->start = start;
+        search->deadline = start + (u64)time_ms * NSEC_PER_MSEC;
+        search->best_move = root->moves[0];
+        search->age = age;
+        search->pickers = &workspace->pickers[i * MAX_PLY];
+    }
+
+    // a helper that cannot be started only makes the search slower
+    for (started = 1; started < threads; started++) {
+        pool[started].pos = *pos;
+        pool[started].root = *root;
+        pool[started].first_depth = 1 + started % 2;
+        pool[started].max_depth = max_depth;
+        init_completion(&pool[started].done);
+        if (IS_ERR(kthread_run(search_helper, &pool[started], "chess_search/%u", started))) {
+            break;
+        }
+    }
+
+    iterate(&pool[0].search, root, 1, max_depth);
+    WRITE_ONCE(abort, true);
+
+    // the deepest completed iteration decides, the main thread on a tie
+    best = &pool[0].search;
+    for (i = 0; i < started; i++) {
+        search = &pool[i].search;
+        if (i > 0) {
+            wait_for_completion(&pool[i].done);
+            if (search->depth > best->depth) {
+                best = search;
+            }
+        }
+        atomic64_add(search->tt_hits, &tt_hits);
+        atomic64_add(search->tt_misses, &tt_misses);
+        atomic64_add(search->tt_collisions, &tt_collisions);
+        atomic64_add(search->nodes, &search_nodes);
+        stats->nodes += search->nodes;
+        stats->tt_hits += search->tt_hits;
+        stats->cutoffs += search->cutoffs;
+        // a depth is reached when the first thread completes it, which is what more threads should speed up
+        for (depth = 1; depth <= MAX_SEARCH_DEPTH; depth++) {
+            if (search->depth_ns[depth] &&
+                (!stats->depth_ns[depth] || search->depth_ns[depth] < stats->depth_ns[depth])) {
+                stats->depth_ns[depth] = search->depth_ns[depth];
+            }
+        }
+    }
+    stats->depth = best->depth;
+    stats->nanoseconds = ktime_get_ns() - start;
+    atomic64_add(stats->nanoseconds, &search_time_ns);
+    atomic64_add(1, &search_count);
+    atomic64_add(stats->depth, &search_depths);
+    return best->best_move;
+}
+
+// allocates a workspace for searches with the number of threads set last, returns NULL if there is no memory
+struct search_workspace *search_workspace_alloc(void) {
+    struct search_workspace *workspace = kzalloc(sizeof(*workspace), GFP_KERNEL);
+
+    if (!workspace) {
+        return NULL;
+    }
+    workspace->threads = READ_ONCE(smp_threads);
+    workspace->pool = vzalloc(workspace->threads * sizeof(*workspace->pool));
+    workspace->pickers = vzalloc(workspace->threads * MAX_PLY * sizeof(*workspace->pickers));
+    if (!workspace->pool || !workspace->pickers) {
+        search_workspace_free(workspace);
+        return NULL;
+    }
+    return workspace;
+}
+
+// release a workspace, which no search may be using
+void search_workspace_free(struct search_workspace *workspace) {
+    if (!workspace) {
+        return;
+    }
+    vfree(workspace->pool);
+    vfree(workspace->pickers);
+    kfree(workspace);
+}
+
+// sets the number of threads that search each CPU move, returns the number used after clamping
+// workspaces allocated before keep the number they were allocated with
+unsigned int search_set_threads(unsigned int threads) {
+    if (threads < 1) {
+        threads = 1;
+    } else if (threads > MAX_SEARCH_THREADS) {
+        threads = MAX_SEARCH_THREADS;
+    }
+    WRITE_ONCE(smp_threads, threads);
+    return threads;
+}
+
+// allocate the transposition table, halving the size until the allocation succeeds
+// returns -ENOMEM if no size fits, a size of 0 disables the table and is not an error
+int tt_allocate(unsigned int size_mb) {
+    u64 buckets = 0;
+
+    if (size_mb > 0) {
+        buckets = rounddown_pow_of_two((u64)size_mb * 1024 * 1024 / (TT_BUCKET_SIZE * sizeof(struct tt_entry)));
+    }
+    while (buckets > 0) {
+        tt_table = vzalloc(buckets * TT_BUCKET_SIZE * sizeof(struct tt_entry));
+        if (tt_table) {
+            tt_mask = buckets - 1;
+            return 0;
+        }
+        buckets >>= 1;
+    }
+    return size_mb > 0 ? -ENOMEM : 0;
+}
+
+// release the transposition table, searches run without one afterwards
+void tt_free(void) {
+    vfree(tt_table);
+    tt_table = NULL;
+    tt_mask = 0;
+}
+
+// size of the transposition table in KB, 0 when there is none
+unsigned long tt_size_kb(void) {
+    if (!tt_table) {
+        return 0;
+    }
+    return (tt_mask + 1) * TT_BUCKET_SIZE * sizeof(struct tt_entry) / 1024;
+}
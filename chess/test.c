@@ -0,0 +1,731 @@
+#include "engine.h"
+
+// unit tests of the engine core, built against the userspace library
+// usage: ./chess_test
+
+static int failures = 0;
+static struct search_workspace *workspace; // one thread, the parallel search test allocates its own
+
+#define EXPECT(cond, ...)                                   \
+    do {                                                    \
+        if (!(cond)) {                                      \
+            printf("FAIL %s:%d: ", __func__, __LINE__);     \
+            printf(__VA_ARGS__);                            \
+            printf("\n");                                   \
+            failures++;                                     \
+        }                                                   \
+    } while (0)
+
+#define KIWIPETE "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"
+
+// the fields of a position that make_move() changes, the undo stack is left out
+static bool same_position(const struct position *a, const struct position *b) {
+    return memcmp(a->pieces, b->pieces, sizeof(a->pieces)) == 0 &&
+           memcmp(a->occupied, b->occupied, sizeof(a->occupied)) == 0 &&
+           memcmp(a->board, b->board, sizeof(a->board)) == 0 &&
+           memcmp(a->king_sq, b->king_sq, sizeof(a->king_sq)) == 0 &&
+           a->all == b->all && a->key == b->key && a->side == b->side && a->castling == b->castling &&
+           a->ep_square == b->ep_square && a->halfmove_clock == b->halfmove_clock &&
+           a->fullmove_number == b->fullmove_number && a->ply == b->ply;
+}
+
+static void test_fen_round_trip(void) {
+    static const char *fens[] = {
+        START_FEN,
+        KIWIPETE,
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "rnbqkbnr/pp1ppppp/8/2p5/4P3/8/PPPP1PPP/RNBQKBNR w KQkq c6 0 2",
+        "4k3/8/8/8/8/8/8/4K2R b K - 12 40",
+    };
+    static struct position pos;
+    char text[128];
+    struct seq_buf out;
+    size_t i;
+
+    for (i = 0; i < sizeof(fens) / sizeof(fens[0]); i++) {
+        EXPECT(load_fen(&pos, fens[i]) == 0, "could not load %s", fens[i]);
+        seq_buf_init(&out, text, sizeof(text));
+        write_fen(&pos, &out);
+        text[seq_buf_used(&out) - 1] = '\0'; // drop the newline
+        EXPECT(strcmp(text, fens[i]) == 0, "%s came back as %s", fens[i], text);
+    }
+}
+
+static void test_fen_rejected(void) {
+    static const char *fens[] = {
+        "",
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1",       // seven ranks
+        "rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", // rank too long
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQ1BNR w KQkq - 0 1", // no white king
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1",
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq e9 0 1",
+        "Pnbqkbnr/pppppppp/8/8/8/8/1PPPPPPP/RNBQKBNR w KQkq - 0 1", // pawn on the last rank
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w  - 0 1",     // empty castling field
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w ",           // castling field missing
+    };
+    static struct position pos, before;
+    size_t i;
+
+    initialize_board(&pos);
+    before = pos;
+    for (i = 0; i < sizeof(fens) / sizeof(fens[0]); i++) {
+        EXPECT(load_fen(&pos, fens[i]) == -EINVAL, "accepted %s", fens[i]);
+        EXPECT(same_position(&pos, &before), "%s changed the position", fens[i]);
+    }
+}
+
+// every legal move of a position and every reply to it must be taken back exactly
+static void test_make_unmake(void) {
+    static const char *fens[] = { START_FEN, KIWIPETE, "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3" };
+    static struct position pos, before, after;
+    struct move_list list, replies;
+    size_t i;
+    int j, k;
+
+    for (i = 0; i < sizeof(fens) / sizeof(fens[0]); i++) {
+        load_fen(&pos, fens[i]);
+        before = pos;
+        generate_legal(&pos, &list);
+        for (j = 0; j < list.count; j++) {
+            make_move(&pos, list.moves[j]);
+            after = pos;
+            generate_moves(&pos, &replies);
+            for (k = 0; k < replies.count; k++) {
+                make_move(&pos, replies.moves[k]);
+                unmake_move(&pos);
+                EXPECT(same_position(&pos, &after), "reply %04x to %04x in %s", replies.moves[k], list.moves[j],
+                       fens[i]);
+            }
+            unmake_move(&pos);
+            EXPECT(same_position(&pos, &before), "move %04x in %s", list.moves[j], fens[i]);
+        }
+    }
+}
+
+// published counts, kept shallow enough for the suite to stay quick
+static void test_perft(void) {
+    static const char position3[] = "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1";
+    static const char position4[] = "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1";
+    static const char position5[] = "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8";
+    static const struct {
+        const char *fen;
+        int depth;
+        u64 nodes;
+    } references[] = {
+        { START_FEN, 1, 20 },
+        { START_FEN, 2, 400 },
+        { START_FEN, 3, 8902 },
+        { START_FEN, 4, 197281 },
+        { KIWIPETE, 1, 48 },
+        { KIWIPETE, 2, 2039 },
+        { KIWIPETE, 3, 97862 },
+        { position3, 1, 14 },
+        { position3, 2, 191 },
+        { position3, 3, 2812 },
+        { position3, 4, 43238 },
+        { position4, 1, 6 },
+        { position4, 2, 264 },
+        { position4, 3, 9467 },
+        { position5, 1, 44 },
+        { position5, 2, 1486 },
+        { position5, 3, 62379 },
+    };
+    static struct move_list lists[4];
+    static struct position pos;
+    size_t i;
+    u64 nodes;
+
+    for (i = 0; i < sizeof(references) / sizeof(references[0]); i++) {
+        load_fen(&pos, references[i].fen);
+        nodes = perft(&pos, references[i].depth, lists);
+        EXPECT(nodes == references[i].nodes, "%s depth %d: %llu nodes, expected %llu", references[i].fen,
+               references[i].depth, (unsigned long long)nodes, (unsigned long long)references[i].nodes);
+    }
+}
+
+static bool list_contains(const struct move_list *list, u16 move) {
+    int i;
+    for (i = 0; i < list->count; i++) {
+        if (list->moves[i] == move) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// every 16 bit value must be accepted exactly when the generator makes it
+static void test_pseudo_legal(void) {
+    static const char *fens[] = {
+        START_FEN,
+        KIWIPETE,
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 b kq - 0 1",
+    };
+    static struct position pos;
+    struct move_list list;
+    size_t i;
+    u32 move;
+
+    for (i = 0; i < sizeof(fens) / sizeof(fens[0]); i++) {
+        load_fen(&pos, fens[i]);
+        generate_moves(&pos, &list);
+        for (move = 0; move <= U16_MAX; move++) {
+            EXPECT(move_is_pseudo_legal(&pos, move) == list_contains(&list, move), "move %04x in %s", move, fens[i]);
+        }
+    }
+}
+
+// the picker hands out every generated move once, the hash move first, captures by MVV-LVA, and killers before quiets
+static void test_move_picker(void) {
+    static struct position pos;
+    static struct move_order order;
+    struct move_picker picker;
+    struct move_list list, seen;
+    u16 move, hash_move, killer;
+    int i, captures = 0, bad_captures = 0, good_captures;
+
+    load_fen(&pos, KIWIPETE);
+    generate_moves(&pos, &list);
+    hash_move = list.moves[list.count - 1];
+    killer = MAKE_MOVE(SQUARE(0, 4), SQUARE(0, 5), MOVE_QUIET); // Kf1
+    order.killers[0][0] = killer;
+    order.killers[0][1] = MAKE_MOVE(SQUARE(0, 0), SQUARE(5, 0), MOVE_QUIET); // not possible here
+
+    seen.count = 0;
+    picker_init(&picker, &pos, &order, hash_move);
+    while ((move = picker_next(&picker))) {
+        EXPECT(!list_contains(&seen, move), "%04x handed out twice", move);
+        seen.moves[seen.count++] = move;
+    }
+    EXPECT(seen.count == list.count, "%d moves handed out of %d", seen.count, list.count);
+    for (i = 0; i < list.count; i++) {
+        EXPECT(list_contains(&seen, list.moves[i]), "%04x never handed out", list.moves[i]);
+        if (MOVE_FLAGS(list.moves[i]) & MOVE_CAPTURE) {
+            captures++;
+            bad_captures += see(&pos, list.moves[i]) < 0;
+        }
+    }
+    good_captures = captures - bad_captures;
+    EXPECT(bad_captures > 0, "no losing capture in kiwipete");
+    EXPECT(seen.moves[0] == hash_move, "hash move %04x came after %04x", hash_move, seen.moves[0]);
+    EXPECT(seen.moves[good_captures + 1] == killer, "killer %04x came after %04x", killer,
+           seen.moves[good_captures + 1]);
+
+    // the bishop taking the bishop on a6 comes first, and the victims only get cheaper after it
+    EXPECT(pos.board[MOVE_TO(seen.moves[1])] == MAKE_PIECE(BLACK, BISHOP) &&
+               PIECE_TYPE(pos.board[MOVE_FROM(seen.moves[1])]) == BISHOP,
+           "first capture %04x", seen.moves[1]);
+    for (i = 2; i <= good_captures; i++) {
+        int previous = PIECE_TYPE(pos.board[MOVE_TO(seen.moves[i - 1])]);
+        EXPECT(PIECE_TYPE(pos.board[MOVE_TO(seen.moves[i])]) <= previous, "capture %04x after %04x", seen.moves[i],
+               seen.moves[i - 1]);
+    }
+
+    // the captures that lose material come after every quiet move
+    for (i = seen.count - bad_captures; i < seen.count; i++) {
+        EXPECT(see(&pos, seen.moves[i]) < 0, "capture %04x is not last", seen.moves[i]);
+    }
+}
+
+static void test_validate_move(void) {
+    static struct position pos;
+
+    initialize_board(&pos);
+    EXPECT(validate_move(&pos, "WPe2-e4"), "double push");
+    EXPECT(validate_move(&pos, "WNg1-f3"), "knight move");
+    EXPECT(!validate_move(&pos, "WPe2-e5"), "pawn moving three squares");
+    EXPECT(!validate_move(&pos, "WBf1-c4"), "bishop jumping over a pawn");
+    EXPECT(!validate_move(&pos, "WQd1-d2"), "queen taking its own pawn");
+    EXPECT(!validate_move(&pos, "WNg1-f3x"), "bad format");
+    EXPECT(!validate_move(&pos, "WKe1-e9"), "off the board");
+    EXPECT(parse_move(&pos, "WPe2-e4") == MAKE_MOVE(SQUARE(1, 4), SQUARE(3, 4), MOVE_QUIET), "packed double push");
+
+    load_fen(&pos, "4k3/P7/8/8/8/8/8/4K3 w - - 0 1");
+    EXPECT(validate_move(&pos, "WPa7-a8yWQ"), "promotion");
+    EXPECT(parse_move(&pos, "WPa7-a8yWQ") ==
+               MAKE_MOVE(SQUARE(6, 0), SQUARE(7, 0), MOVE_PROMOTION | (QUEEN - KNIGHT)),
+           "packed promotion");
+
+    // castling is the king's two square move and en passant names the pawn it takes
+    load_fen(&pos, "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3");
+    EXPECT(validate_move(&pos, "WPe5-f6xBP"), "en passant");
+    EXPECT(!validate_move(&pos, "WPe5-d6xBP"), "en passant of a pawn that did not just pass");
+    load_fen(&pos, KIWIPETE);
+    EXPECT(validate_move(&pos, "WKe1-g1"), "castling");
+    EXPECT(!validate_move(&pos, "WKe1-e3"), "king moving two ranks");
+}
+
+// two moves with the same squares and the same promotion, whatever their other flags
+static bool same_squares(u16 a, u16 b) {
+    bool promotion = MOVE_FLAGS(a) & MOVE_PROMOTION;
+    return MOVE_FROM(a) == MOVE_FROM(b) && MOVE_TO(a) == MOVE_TO(b) &&
+           promotion == !!(MOVE_FLAGS(b) & MOVE_PROMOTION) && (!promotion || MOVE_PROMOTED(a) == MOVE_PROMOTED(b));
+}
+
+// the legality test the masks replace: make the move and see if the mover's king is attacked
+static bool legal_by_making(struct position *pos, u16 move) {
+    bool legal;
+
+    make_move(pos, move);
+    legal = !square_attacked_by(pos, pos->side, king_square(pos, !pos->side));
+    unmake_move(pos);
+    return legal;
+}
+
+// castling moves the rook too and en passant takes the pawn beside the destination, and the hash key of the
+// position reached is the one the same position gets from its FEN
+static void test_special_moves(void) {
+    static const struct {
+        const char *fen;
+        u16 move;
+        const char *after;
+    } moves[] = {
+        { KIWIPETE, MAKE_MOVE(SQUARE(0, 4), SQUARE(0, 6), MOVE_KING_CASTLE),
+          "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R4RK1 b kq - 1 1" },
+        { KIWIPETE, MAKE_MOVE(SQUARE(0, 4), SQUARE(0, 2), MOVE_QUEEN_CASTLE),
+          "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/2KR3R b kq - 1 1" },
+        { "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+          MAKE_MOVE(SQUARE(4, 4), SQUARE(5, 5), MOVE_EN_PASSANT),
+          "rnbqkbnr/ppp1p1pp/5P2/3p4/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 3" },
+        { START_FEN, MAKE_MOVE(SQUARE(1, 4), SQUARE(3, 4), MOVE_DOUBLE_PUSH),
+          "rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1" },
+    };
+    static struct position pos, expected;
+    struct move_list list;
+    size_t i;
+
+    for (i = 0; i < sizeof(moves) / sizeof(moves[0]); i++) {
+        load_fen(&pos, moves[i].fen);
+        EXPECT(find_legal_move(&pos, moves[i].move) == moves[i].move, "move %04x in %s", moves[i].move, moves[i].fen);
+        commit_move(&pos, moves[i].move);
+        load_fen(&expected, moves[i].after);
+        EXPECT(same_position(&pos, &expected), "move %04x in %s", moves[i].move, moves[i].fen);
+    }
+
+    // no castling out of check, through an attacked square, or with a piece in between
+    load_fen(&pos, "r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    EXPECT(find_legal_move(&pos, MAKE_MOVE(SQUARE(0, 4), SQUARE(0, 6), MOVE_QUIET)), "castling on an open board");
+    load_fen(&pos, "r3k2r/8/8/8/8/8/8/R3K1NR w KQkq - 0 1");
+    EXPECT(!find_legal_move(&pos, MAKE_MOVE(SQUARE(0, 4), SQUARE(0, 6), MOVE_QUIET)), "castling through a knight");
+    load_fen(&pos, "r3k2r/8/8/8/8/8/5r2/R3K2R w KQkq - 0 1");
+    EXPECT(!find_legal_move(&pos, MAKE_MOVE(SQUARE(0, 4), SQUARE(0, 6), MOVE_QUIET)), "castling through f1");
+    load_fen(&pos, "r3k2r/8/8/8/8/8/4r3/R3K2R w KQkq - 0 1");
+    EXPECT(!find_legal_move(&pos, MAKE_MOVE(SQUARE(0, 4), SQUARE(0, 2), MOVE_QUIET)), "castling out of check");
+
+    // mate and stalemate both leave no legal move, and only mate leaves the king in check
+    load_fen(&pos, "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1");
+    generate_legal(&pos, &list);
+    EXPECT(list.count == 0, "stalemate has a move");
+    load_fen(&pos, "7k/6Q1/6K1/8/8/8/8/8 b - - 0 1");
+    generate_legal(&pos, &list);
+    EXPECT(list.count == 0, "mate has a move");
+
+    load_fen(&pos, "8/8/4k3/8/8/3BK3/8/8 w - - 0 1");
+    EXPECT(insufficient_material(&pos), "king and bishop against king");
+    load_fen(&pos, "8/3b4/4k3/8/8/3BK3/8/8 w - - 0 1");
+    EXPECT(insufficient_material(&pos), "bishops on light squares");
+    load_fen(&pos, "8/2b5/4k3/8/8/3BK3/8/8 w - - 0 1");
+    EXPECT(!insufficient_material(&pos), "bishops on squares of both colors");
+    load_fen(&pos, "8/8/4k3/8/8/3NK3/3N4/8 w - - 0 1");
+    EXPECT(!insufficient_material(&pos), "two knights");
+    load_fen(&pos, "8/8/4k3/8/8/4K3/3P4/8 w - - 0 1");
+    EXPECT(!insufficient_material(&pos), "a pawn");
+}
+
+// the mask test must agree with making the move and looking for a check, in each position and after each reply
+static void test_legality(void) {
+    static const char *fens[] = {
+        KIWIPETE,
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "8/8/3k4/KPp4r/8/8/8/8 w - c6 0 2",      // en passant would expose the king along the rank
+        "8/4b3/8/2Pp4/8/K7/8/4k3 w - d6 0 1",     // en passant along the line of a pin
+        "4k3/8/8/8/3pP3/8/8/4K3 b - e3 0 1",      // en passant that takes the checking pawn
+        "r3k3/8/8/8/8/8/3q4/R3K2R w KQq - 0 1",   // the king in check next to the checker
+    };
+    static struct position pos;
+    struct legality legality;
+    struct move_list list, replies;
+    size_t i;
+    int j, k;
+    u32 move;
+
+    for (i = 0; i < sizeof(fens) / sizeof(fens[0]); i++) {
+        EXPECT(load_fen(&pos, fens[i]) == 0, "rejected %s", fens[i]);
+        generate_moves(&pos, &list);
+        for (j = 0; j < list.count; j++) {
+            compute_legality(&pos, &legality);
+            EXPECT(move_is_legal(&pos, &legality, list.moves[j]) == legal_by_making(&pos, list.moves[j]),
+                   "move %04x in %s", list.moves[j], fens[i]);
+            make_move(&pos, list.moves[j]);
+            if (!square_attacked_by(&pos, pos.side, king_square(&pos, !pos.side))) {
+                generate_moves(&pos, &replies);
+                compute_legality(&pos, &legality);
+                for (k = 0; k < replies.count; k++) {
+                    EXPECT(move_is_legal(&pos, &legality, replies.moves[k]) == legal_by_making(&pos, replies.moves[k]),
+                           "reply %04x to %04x in %s", replies.moves[k], list.moves[j], fens[i]);
+                }
+            }
+            unmake_move(&pos);
+        }
+
+        // a move is found from its squares and promotion alone exactly when it is legal
+        generate_legal(&pos, &list);
+        for (move = 0; move <= U16_MAX; move++) {
+            u16 found = find_legal_move(&pos, move);
+            EXPECT(found == 0 || (list_contains(&list, found) && same_squares(found, move)), "found %04x for %04x in %s",
+                   found, move, fens[i]);
+        }
+        for (j = 0; j < list.count; j++) {
+            EXPECT(find_legal_move(&pos, list.moves[j]) == list.moves[j], "move %04x not found in %s", list.moves[j],
+                   fens[i]);
+        }
+    }
+}
+
+// the incrementally kept scores must equal those of the same position set up from scratch
+static bool same_scores(const struct position *pos) {
+    static struct position fresh;
+    char text[128];
+    struct seq_buf out;
+
+    seq_buf_init(&out, text, sizeof(text));
+    write_fen(pos, &out);
+    text[seq_buf_used(&out) - 1] = '\0';
+    load_fen(&fresh, text);
+    return pos->material == fresh.material && pos->placement[PHASE_MG] == fresh.placement[PHASE_MG] &&
+           pos->placement[PHASE_EG] == fresh.placement[PHASE_EG] && pos->phase == fresh.phase;
+}
+
+static void test_eval_incremental(void) {
+    static const char *fens[] = { KIWIPETE, "4k3/1P6/8/8/8/8/6p1/4K2R w - - 0 1" };
+    static struct position pos;
+    struct move_list list, replies;
+    size_t i;
+    int j, k;
+
+    for (i = 0; i < sizeof(fens) / sizeof(fens[0]); i++) {
+        load_fen(&pos, fens[i]);
+        generate_legal(&pos, &list);
+        for (j = 0; j < list.count; j++) {
+            make_move(&pos, list.moves[j]);
+            EXPECT(same_scores(&pos), "move %04x in %s", list.moves[j], fens[i]);
+            generate_moves(&pos, &replies);
+            for (k = 0; k < replies.count; k++) {
+                make_move(&pos, replies.moves[k]);
+                EXPECT(same_scores(&pos), "reply %04x to %04x in %s", replies.moves[k], list.moves[j], fens[i]);
+                unmake_move(&pos);
+            }
+            unmake_move(&pos);
+        }
+        EXPECT(same_scores(&pos), "taking back every move in %s", fens[i]);
+    }
+}
+
+// a position and its color-flipped mirror must score the same for the side to move
+static void test_eval_symmetry(void) {
+    static const char *fens[][2] = {
+        { START_FEN, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR b KQkq - 0 1" },
+        { KIWIPETE, "r3k2r/pppbbppp/2n2q1P/1P2p3/3pn3/BN2PNP1/P1PPQPB1/R3K2R b KQkq - 0 1" },
+        { "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", "r5k1/8/8/8/8/8/5PPP/6K1 b - - 0 1" },
+    };
+    static struct position pos;
+    struct eval_terms terms;
+    size_t i;
+    int score;
+
+    initialize_board(&pos);
+    evaluate_terms(&pos, &terms);
+    EXPECT(terms.total == 0, "start position scores %d", terms.total);
+    for (i = 0; i < sizeof(fens) / sizeof(fens[0]); i++) {
+        load_fen(&pos, fens[i][0]);
+        score = evaluate(&pos);
+        load_fen(&pos, fens[i][1]);
+        EXPECT(evaluate(&pos) == score, "%s scores %d, its mirror %d", fens[i][0], score, evaluate(&pos));
+    }
+
+    // a queen up outweighs anything else
+    load_fen(&pos, "4k3/8/8/8/8/8/8/3QK3 w - - 0 1");
+    EXPECT(evaluate(&pos) > piece_values[QUEEN] / 2, "queen up scores %d", evaluate(&pos));
+}
+
+// exchanges on one square, counted with the piece values of the evaluation
+static void test_see(void) {
+    static struct position pos;
+    u16 move;
+
+    load_fen(&pos, "1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1");
+    move = MAKE_MOVE(SQUARE(0, 4), SQUARE(4, 4), MOVE_CAPTURE);
+    EXPECT(see(&pos, move) == piece_values[PAWN], "rook taking a loose pawn: %d", see(&pos, move));
+
+    load_fen(&pos, "4k3/8/3p4/4p3/8/8/8/4Q1K1 w - - 0 1");
+    move = MAKE_MOVE(SQUARE(0, 4), SQUARE(4, 4), MOVE_CAPTURE);
+    EXPECT(see(&pos, move) == piece_values[PAWN] - piece_values[QUEEN], "queen taking a defended pawn: %d",
+           see(&pos, move));
+
+    // the rook behind the first one recaptures through it
+    load_fen(&pos, "4r1k1/8/8/4p3/8/8/4R3/4R1K1 w - - 0 1");
+    move = MAKE_MOVE(SQUARE(1, 4), SQUARE(4, 4), MOVE_CAPTURE);
+    EXPECT(see(&pos, move) == piece_values[PAWN], "doubled rooks taking a defended pawn: %d", see(&pos, move));
+
+    // the king cannot take back on a square the queen behind the rook still covers
+    load_fen(&pos, "4q1k1/4r3/8/8/8/8/4Q3/4K3 b - - 0 1");
+    move = MAKE_MOVE(SQUARE(6, 4), SQUARE(1, 4), MOVE_CAPTURE);
+    EXPECT(see(&pos, move) == piece_values[QUEEN], "rook taking a queen only the king defends: %d",
+           see(&pos, move));
+}
+
+// the quiescence search sees the recapture a fixed depth would miss
+static void test_quiescence(void) {
+    static struct position pos;
+    struct move_list list;
+    struct search_stats stats;
+    bool cancel = false;
+    u16 move;
+
+    load_fen(&pos, "4k3/8/3p4/4p3/8/8/8/4Q1K1 w - - 0 1");
+    generate_legal(&pos, &list);
+    move = search_best_move(workspace, &pos, NULL, &list, 1, 1000, &cancel, &stats);
+    EXPECT(move != MAKE_MOVE(SQUARE(0, 4), SQUARE(4, 4), MOVE_CAPTURE), "queen took a defended pawn");
+}
+
+static void test_mate_in_one(void) {
+    static struct position pos;
+    struct move_list list;
+    struct search_stats stats;
+    bool cancel = false;
+    u16 move;
+
+    load_fen(&pos, "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+    generate_legal(&pos, &list);
+    move = search_best_move(workspace, &pos, NULL, &list, 3, 1000, &cancel, &stats);
+    EXPECT(move == MAKE_MOVE(SQUARE(0, 0), SQUARE(7, 0), MOVE_QUIET), "found %04x", move);
+    EXPECT(stats.depth == 1, "search went on to depth %d after finding the mate", stats.depth);
+
+    commit_move(&pos, move);
+    generate_legal(&pos, &list);
+    EXPECT(list.count == 0 && square_attacked_by(&pos, WHITE, king_square(&pos, BLACK)), "back rank mate");
+}
+
+// helper threads search the same root and their nodes are counted with those of the main thread
+static void test_parallel_search(void) {
+    static struct position pos;
+    struct move_list list;
+    struct search_stats stats;
+    bool cancel = false;
+    long long nodes = atomic64_read(&search_nodes);
+    struct search_workspace *parallel;
+    u64 key;
+    u16 move;
+    int depth;
+
+    EXPECT(search_set_threads(0) == 1 && search_set_threads(MAX_SEARCH_THREADS + 1) == MAX_SEARCH_THREADS,
+           "thread count not clamped");
+    search_set_threads(4);
+    parallel = search_workspace_alloc();
+    search_set_threads(1);
+    if (!parallel) {
+        EXPECT(false, "could not allocate a workspace for 4 threads");
+        return;
+    }
+    load_fen(&pos, "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+    generate_legal(&pos, &list);
+    move = search_best_move(parallel, &pos, NULL, &list, 5, 1000, &cancel, &stats);
+    EXPECT(move == MAKE_MOVE(SQUARE(0, 0), SQUARE(7, 0), MOVE_QUIET), "found %04x", move);
+    EXPECT(stats.nodes == (u64)(atomic64_read(&search_nodes) - nodes), "stats hold %llu nodes, the totals %lld",
+           (unsigned long long)stats.nodes, atomic64_read(&search_nodes) - nodes);
+
+    // every thread leaves the position it searched as it found it
+    load_fen(&pos, KIWIPETE);
+    key = pos.key;
+    generate_legal(&pos, &list);
+    search_best_move(parallel, &pos, NULL, &list, 4, 1000, &cancel, &stats);
+    EXPECT(pos.ply == 0 && pos.key == key, "position changed by the search");
+    EXPECT(stats.depth >= 1 && stats.depth <= 4 && stats.cutoffs > 0 && stats.tt_hits > 0,
+           "depth %d, %llu cutoffs, %llu hash hits", stats.depth, (unsigned long long)stats.cutoffs,
+           (unsigned long long)stats.tt_hits);
+    // every depth up to the deepest completed iteration was reached by some thread, and no deeper one
+    for (depth = 1; depth <= MAX_SEARCH_DEPTH; depth++) {
+        EXPECT((stats.depth_ns[depth] != 0) == (depth <= stats.depth),
+               "depth %d reached after %llu ns, the search completed depth %d", depth,
+               (unsigned long long)stats.depth_ns[depth], stats.depth);
+    }
+    search_workspace_free(parallel);
+}
+
+// plays a move for good and records it the way a game does
+static void play(struct position *pos, struct game_history *history, u16 move) {
+    history_push(history, pos->key, move);
+    commit_move(pos, move);
+}
+
+// repetitions are found through the moves made on a position and then the game history, back to the last pawn move
+static void test_history(void) {
+    static struct position pos;
+    static struct game_history history;
+    static const u16 shuffle[] = {
+        MAKE_MOVE(SQUARE(0, 6), SQUARE(2, 5), MOVE_QUIET), // Nf3
+        MAKE_MOVE(SQUARE(7, 6), SQUARE(5, 5), MOVE_QUIET), // Nf6
+        MAKE_MOVE(SQUARE(2, 5), SQUARE(0, 6), MOVE_QUIET), // Ng1
+        MAKE_MOVE(SQUARE(5, 5), SQUARE(7, 6), MOVE_QUIET), // Ng8
+    };
+    u16 e4 = MAKE_MOVE(SQUARE(1, 4), SQUARE(3, 4), MOVE_DOUBLE_PUSH);
+    u16 moves[8];
+    u32 i, first, count;
+
+    initialize_board(&pos);
+    history_clear(&history);
+    play(&pos, &history, e4);
+    for (i = 0; i < 8; i++) {
+        EXPECT(count_repetitions(&pos, &history, 2) == (int)i / 4, "%d repetitions after %u moves",
+               count_repetitions(&pos, &history, 2), i);
+        play(&pos, &history, shuffle[i % 4]);
+    }
+    EXPECT(count_repetitions(&pos, &history, 2) == 2, "threefold repetition missed");
+    EXPECT(count_repetitions(&pos, &history, 1) == 1, "count not limited");
+
+    // the same when the last moves were made on the position instead of recorded in the history
+    initialize_board(&pos);
+    history_clear(&history);
+    play(&pos, &history, e4);
+    for (i = 0; i < 6; i++) {
+        play(&pos, &history, shuffle[i % 4]);
+    }
+    make_move(&pos, shuffle[2]);
+    make_move(&pos, shuffle[3]);
+    EXPECT(count_repetitions(&pos, NULL, 2) == 0, "repetition without the history");
+    EXPECT(count_repetitions(&pos, &history, 2) == 2, "repetition across the undo stack and the history");
+
+    // the ring keeps the last GAME_HISTORY_SIZE moves
+    history_clear(&history);
+    for (i = 0; i < GAME_HISTORY_SIZE + 3; i++) {
+        history_push(&history, i, (u16)i);
+    }
+    count = history_read(&history, 0, moves, ARRAY_SIZE(moves), &first);
+    EXPECT(first == 3 && count == ARRAY_SIZE(moves) && moves[0] == 3, "read from %u, %u moves", first, count);
+    count = history_read(&history, GAME_HISTORY_SIZE + 1, moves, ARRAY_SIZE(moves), &first);
+    EXPECT(first == GAME_HISTORY_SIZE + 1 && count == 2 && moves[1] == GAME_HISTORY_SIZE + 2, "tail of %u moves",
+           count);
+}
+
+// the keys the Polyglot format gives for the start position and the positions after a few moves
+static void test_polyglot_key(void) {
+    static const struct {
+        const char *fen;
+        u64 key;
+    } keys[] = {
+        {START_FEN, 0x463b96181691fc9cULL},
+        {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823c9b50fd114196ULL},
+        {"rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", 0x0756b94461c50fb0ULL},
+        {"rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", 0x662fafb965db29d4ULL},
+        {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", 0x22a48b5a8e47ff78ULL},
+        {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", 0x652a607ca3f242c1ULL},
+        {"rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", 0x00fdd303c946bdd9ULL},
+        {"rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", 0x3c8123ea7b067637ULL},
+        {"rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", 0x5c3f9b829b279560ULL},
+    };
+    static struct position pos;
+    size_t i;
+
+    for (i = 0; i < ARRAY_SIZE(keys); i++) {
+        load_fen(&pos, keys[i].fen);
+        EXPECT(polyglot_key(&pos) == keys[i].key, "key %016llx instead of %016llx for %s",
+               (unsigned long long)polyglot_key(&pos), (unsigned long long)keys[i].key, keys[i].fen);
+    }
+}
+
+// appends a book entry the way a book file stores it, big-endian
+static void put_book_entry(u8 *entry, u64 key, int from, int to, int weight) {
+    u16 move = to | from << 6;
+    int i;
+
+    for (i = 0; i < 8; i++) {
+        entry[i] = key >> (56 - 8 * i);
+    }
+    entry[8] = move >> 8;
+    entry[9] = move;
+    entry[10] = weight >> 8;
+    entry[11] = weight;
+    memset(entry + 12, 0, 4);
+}
+
+// book moves are found by key, chosen by weight, and only played when legal
+static void test_book(void) {
+    static struct position pos;
+    u8 book[5 * 16];
+    int i, e4 = 0, d4 = 0, other = 0;
+    u16 move;
+
+    initialize_board(&pos);
+    put_book_entry(book, 0, SQUARE(1, 0), SQUARE(2, 0), 1);
+    put_book_entry(book + 16, polyglot_key(&pos), SQUARE(1, 4), SQUARE(3, 4), 3);  // e2e4
+    put_book_entry(book + 32, polyglot_key(&pos), SQUARE(1, 4), SQUARE(4, 4), 50); // e2e5 is not legal
+    put_book_entry(book + 48, polyglot_key(&pos), SQUARE(1, 3), SQUARE(3, 3), 1);  // d2d4
+    put_book_entry(book + 64, ~0ULL, SQUARE(1, 7), SQUARE(2, 7), 1);
+    EXPECT(book_load(book, sizeof(book)) == 0 && book_size() == 5, "book not loaded");
+
+    for (i = 0; i < 400; i++) {
+        move = book_probe(&pos);
+        e4 += move == MAKE_MOVE(SQUARE(1, 4), SQUARE(3, 4), MOVE_DOUBLE_PUSH);
+        d4 += move == MAKE_MOVE(SQUARE(1, 3), SQUARE(3, 3), MOVE_DOUBLE_PUSH);
+        other += move != MAKE_MOVE(SQUARE(1, 4), SQUARE(3, 4), MOVE_DOUBLE_PUSH) &&
+                 move != MAKE_MOVE(SQUARE(1, 3), SQUARE(3, 3), MOVE_DOUBLE_PUSH);
+    }
+    EXPECT(other == 0 && d4 > 0 && e4 > 2 * d4, "e4 %d times, d4 %d times, others %d times", e4, d4, other);
+
+    load_fen(&pos, KIWIPETE);
+    EXPECT(book_probe(&pos) == 0, "book move in a position not in the book");
+
+    // castling is written as the king taking its own rook
+    put_book_entry(book, polyglot_key(&pos), SQUARE(0, 4), SQUARE(0, 0), 1); // e1a1
+    EXPECT(book_load(book, 16) == 0 && book_probe(&pos) == MAKE_MOVE(SQUARE(0, 4), SQUARE(0, 2), MOVE_QUEEN_CASTLE),
+           "e1a1 not played as queenside castling");
+    put_book_entry(book, polyglot_key(&pos), SQUARE(0, 4), SQUARE(0, 7), 1); // e1h1
+    EXPECT(book_load(book, 16) == 0 && book_probe(&pos) == MAKE_MOVE(SQUARE(0, 4), SQUARE(0, 6), MOVE_KING_CASTLE),
+           "e1h1 not played as kingside castling");
+
+    // the entries have to be sorted by key
+    memcpy(book, book + 64, 16);
+    EXPECT(book_load(book, sizeof(book)) == -EINVAL && book_size() == 0, "unsorted book loaded");
+    EXPECT(book_load(book, 15) == -EINVAL, "truncated book loaded");
+    book_free();
+}
+
+int main(void) {
+    engine_init();
+    if (tt_allocate(1)) {
+        printf("could not allocate the transposition table\n");
+        return EXIT_FAILURE;
+    }
+    workspace = search_workspace_alloc();
+    if (!workspace) {
+        printf("could not allocate the search workspace\n");
+        tt_free();
+        return EXIT_FAILURE;
+    }
+
+    test_fen_round_trip();
+    test_fen_rejected();
+    test_make_unmake();
+    test_special_moves();
+    test_legality();
+    test_perft();
+    test_validate_move();
+    test_pseudo_legal();
+    test_move_picker();
+    test_eval_incremental();
+    test_eval_symmetry();
+    test_see();
+    test_quiescence();
+    test_mate_in_one();
+    test_parallel_search();
+    test_history();
+    test_polyglot_key();
+    test_book();
+
+    search_workspace_free(workspace);
+    tt_free();
+    printf("%d failures\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+/*
+description: checks moves written in the text protocol against the rules of each piece
+*/
+#include "engine.h"
+
+// helper function that determines if there is a obstacle in the way for pawn, bishop, rook, and queen moves
+static bool obstacles(const struct position *pos, int from, int to) {
+    return (between_mask[from][to] & pos->all) != 0;
+}
+
+// square of the piece a capture takes, a pawn capturing onto the en passant square takes the pawn beside it
+static int captured_square(const struct position *pos, char type, int to) {
+    if (type != 'P' || to != pos->ep_square) {
+        return to;
+    }
+    return pos->side == WHITE ? to - BOARD_SIZE : to + BOARD_SIZE;
+}
+
+bool validate_move(const struct position *pos, const char *move) {
+    int from_col, from_row, to_col, to_row, from, to, piece;
+    size_t move_len = strlen(move);
+
+    if (move_len != 7 && move_len != 10 && move_len != 13) {
+        return false; // invalid move format
+    }
+
+    from_col = move[2] - 'a';
+    from_row = move[3] - '1';
+    to_col = move[5] - 'a';
+    to_row = move[6] - '1';
+
+    if (move[0] != 'W' && move[0] != 'B') {
+        return false; // invalid piece color
+    }
+    if (from_row < 0 || from_row >= 8 || from_col < 0 || from_col >= 8 ||
+        to_row < 0 || to_row >= 8 || to_col < 0 || to_col >= 8) {
+        return false; // out of bounds
+    }
+    if (move[4] != '-') {
+        return false; // bad marker
+    }
+    from = SQUARE(from_row, from_col);
+    to = SQUARE(to_row, to_col);
+    piece = parse_piece(move);
+    if (piece < 0) {
+        return false; // bad piece type
+    }
+    if (pos->board[from] != piece) {
+        return false; // piece is not present at the source square
+    }
+
+    // check that the movement of the piece is valid
+    if (move[1] == 'P') {
+        if (move_len == 7) {
+            if (move[0] == 'W') {
+                if (!(from_col == to_col && (from_row + 1 == to_row || (from_row == 1 && to_row == 3)))) {
+                    return false; // invalid pawn move for White
+                }
+                if (to_row == 7) {
+                    return false; // need to promote
+                }
+            } else {
+                if (!(from_col == to_col && (from_row - 1 == to_row || (from_row == 6 && to_row == 4)))) {
+                    return false; // invalid pawn move for Black
+                }
+                if (to_row == 0) {
+                    return false; // need to promote
+                }
+            }
+            if (obstacles(pos, from, to)) {
+                return false; // pieces cannot move through other pieces
+            }
+        }
+    } else if (move[1] == 'N') {
+        int row_diff = abs(to_row - from_row);
+        int col_diff = abs(to_col - from_col);
+        if (!((row_diff == 2 && col_diff == 1) || (row_diff == 1 && col_diff == 2))) {
+            return false; // bad knight move
+        }
+    } else if (move[1] == 'B') {
+        if (!(abs(to_row - from_row) == abs(to_col - from_col))) {
+            return false; // bad bishop move
+        }
+        if (obstacles(pos, from, to)) {
+            return false; // pieces cannot move through other pieces
+        }
+    } else if (move[1] == 'R') {
+        if (!(from_row == to_row || from_col == to_col)) {
+            return false; // bad rook move
+        }
+        if (obstacles(pos, from, to)) {
+            return false; // pieces cannot move through other pieces
+        }
+    } else if (move[1] == 'Q') {
+        if (!(from_row == to_row || from_col == to_col || abs(to_row - from_row) == abs(to_col - from_col))) {
+            return false; // bad queen move
+        }
+        if (obstacles(pos, from, to)) {
+            return false; // pieces cannot move through other pieces
+        }
+    } else if (move[1] == 'K') {
+        // two squares along the first rank is castling, whether the rights and squares allow it is the generator's call
+        bool castling = from_col == 4 && from_row == to_row && abs(to_col - from_col) == 2;
+        if (!((abs(to_row - from_row) <= 1) && (abs(to_col - from_col) <= 1)) && !castling) {
+            return false; // bad king move
+        }
+    }
+
+    // check that the destination is empty
+    if (move_len == 7) {
+        if (pos->board[to] != NO_PIECE) {
+            return false; // no empty space
+        }
+    }
+
+    if (move_len == 10) {
+        if (move[7] == 'x') {
+            if (move[8] != 'W' && move[8] != 'B') {
+                return false; // invalid capturing piece color
+            }
+            if (move[8] == move[0]) {
+                return false; // capturing own piece
+            }
+            if (pos->board[captured_square(pos, move[1], to)] != parse_piece(move + 8)) {
+                return false; // piece to be captured isn't present
+            }
+            if (move[1] == 'P') {
+                if (move[0] == 'W') {
+                    if ((to_row != from_row + 1 || abs(to_col - from_col) != 1)) {
+                        return false; // invalid pawn capture for white
+                    }
+                    if (to_row == 7) {
+                        return false; // need to promote
+                    }
+                } else {
+                    if ((to_row != from_row - 1 || abs(to_col - from_col) != 1)) {
+                        return false; // invalid pawn capture for black
+                    }
+                    if (to_row == 0) {
+                        return false; // need to promote
+                    }
+                }
+            }
+        } else if (move[7] == 'y') {
+            if (move[1] != 'P') {
+                return false; // promoted piece is not pawn 
+            }
+            if (move[0] != move[8]) {
+                return false; // color of promotion is invalid
+            }
+            if (move[9] != 'Q' && move[9] != 'R' && move[9] != 'B' && move[9] != 'N') {
+                return false; // type of peice to be promoted is invalid
+            }
+            if (move[0] == 'W') {
+                if (from_row != 6 || to_row != 7 || from_col != to_col) {
+                    return false; // invalid move
+                }
+            } else {
+                if (from_row != 1 || to_row != 0 || from_col != to_col) {
+                    return false; // invalid move
+                }
+            }
+            if (pos->board[to] != NO_PIECE) {
+                return false; // make sure that the tile is empty
+            }
+        }
+        else {
+            // bad marker
+            return false; 
+        }
+    }
+
+    if (move_len == 13) {
+        if (move[1] != 'P') {
+            return false;
+        }
+        if (move[0] != move[11]) {
+            return false; // promoted piece color doesn't match the pawn color
+        }
+        if (move[7] != 'x') {
+            return false; // invalid marker for capture move
+        }
+        if (move[10] != 'y') {
+            return false; // bad marker for promotion after capture
+        }
+        if (move[8] != 'W' && move[8] != 'B') {
+            return false; // invalid capturing piece color
+        }
+        if (move[8] == move[0]) {
+            return false; // capturing own piece
+        }
+        if (pos->board[to] != parse_piece(move + 8)) {
+            return false; // piece to be captured isn't present
+        }
+        if (move[0] == 'W') {
+            if ((from_row != 6 || to_row != 7 || abs(to_col - from_col) != 1 )) {
+                return false; // invalid pawn capture for White
+            }
+        } else {
+            if ((from_row != 1 || to_row != 0|| abs(to_col - from_col) != 1)) {
+                return false; // invalid pawn capture for Black
+            }
+        }
+
+        if (move[12] != 'Q' && move[12] != 'R' && move[12] != 'B' && move[12] != 'N') {
+            return false; // wrong type of promotion
+        }
+    }
+
+    return true;
+}
+
+// converts a validated move string into a packed move, castling and en passant flags are left to find_legal_move()
+u16 parse_move(const struct position *pos, const char *move) {
+    int from = SQUARE(move[3] - '1', move[2] - 'a');
+    int to = SQUARE(move[6] - '1', move[5] - 'a');
+    size_t move_len = strlen(move);
+    int flags = MOVE_QUIET;
+
+    if (pos->board[to] != NO_PIECE) {
+        flags |= MOVE_CAPTURE;
+    }
+    // promotions name the new piece at the end of the move
+    if (move_len == 13 || (move_len == 10 && move[7] == 'y')) {
+        flags |= MOVE_PROMOTION | ((strchr(type_chars, move[move_len - 1]) - type_chars) - KNIGHT);
+    }
+    return MAKE_MOVE(from, to, flags);
+}